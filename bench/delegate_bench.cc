@@ -0,0 +1,110 @@
+// Compares the handlers bound with std::bind against ui::Delegate:
+// heap allocations and storage per widget, and dispatch cost.
+// Exits non-zero if a Delegate allocates (also when wrapped in std::function).
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <vector>
+
+#include <coreds/nana/ui.h>
+
+static std::atomic<long> allocations{ 0 };
+
+void* operator new(std::size_t size)
+{
+    allocations++;
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+struct Row
+{
+    int clicks{ 0 };
+    // the shape of Pager::onLabelEvent
+    void onEvent(int cmd, const std::string& target)
+    {
+        clicks += cmd + static_cast<int>(target.size());
+    }
+};
+
+typedef std::function<void(int cmd, const std::string& target)> Handler;
+typedef ui::Delegate<void(int cmd, const std::string& target)> RowDelegate;
+
+template <typename H>
+static double dispatch(std::vector<H>& handlers, int rounds)
+{
+    const std::string target("7");
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++)
+    {
+        for (auto& h : handlers)
+            h(r & 1, target);
+    }
+    auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start);
+    return elapsed.count() / (static_cast<double>(rounds) * handlers.size());
+}
+
+int main(int argc, char* argv[])
+{
+    const int widgets = argc > 1 ? std::atoi(argv[1]) : 5000;
+    const int rounds = argc > 2 ? std::atoi(argv[2]) : 2000;
+    
+    std::vector<Row> rows(widgets);
+    std::vector<Handler> bound;
+    std::vector<RowDelegate> delegates;
+    std::vector<Handler> wrapped;
+    bound.reserve(widgets);
+    delegates.reserve(widgets);
+    wrapped.reserve(widgets);
+    
+    long before = allocations;
+    for (auto& row : rows)
+        bound.push_back(std::bind(&Row::onEvent, &row, std::placeholders::_1, std::placeholders::_2));
+    long bind_allocs = allocations - before;
+    
+    before = allocations;
+    for (auto& row : rows)
+        delegates.push_back(RowDelegate::bind<Row, &Row::onEvent>(&row));
+    long delegate_allocs = allocations - before;
+    
+    // what nana's event registration does with a Delegate
+    before = allocations;
+    for (auto& d : delegates)
+        wrapped.push_back(d);
+    long wrapped_allocs = allocations - before;
+    
+    double bind_ns = dispatch(bound, rounds);
+    double delegate_ns = dispatch(delegates, rounds);
+    double wrapped_ns = dispatch(wrapped, rounds);
+    
+    std::printf("widgets: %d, rounds: %d\n", widgets, rounds);
+    std::printf("std::bind:               %ld allocs, %zu bytes + heap, %.2f ns/dispatch\n",
+            bind_allocs, sizeof(Handler), bind_ns);
+    std::printf("Delegate:                %ld allocs, %zu bytes, %.2f ns/dispatch\n",
+            delegate_allocs, sizeof(RowDelegate), delegate_ns);
+    std::printf("std::function(Delegate): %ld allocs, %zu bytes, %.2f ns/dispatch\n",
+            wrapped_allocs, sizeof(Handler), wrapped_ns);
+    
+    // keeps the dispatch loops from being optimized out
+    long total = 0;
+    for (auto& row : rows)
+        total += row.clicks;
+    std::printf("checksum: %ld\n", total);
+    
+    return delegate_allocs == 0 && wrapped_allocs == 0 ? 0 : 1;
+}
@@ -0,0 +1,128 @@
+// A synchronous stand-in for coreds::PojoStore, put ahead of the real one on
+// replay_bench's include path so that the store-backed paths of ui::Pager run
+// without a backend. The records come from $fetch instead of a server.
+
+#pragma once
+
+#include <functional>
+
+namespace coreds {
+
+template <typename T, typename F>
+struct PojoStore
+{
+    // the record at the position in ascending order
+    std::function<T*(int idx)> $fetch;
+    std::function<void()> $beforePopulate;
+    std::function<void(int idx, T* pojo)> $populate;
+    std::function<void(int selectedIdx)> $afterPopulate;
+    int total{ 0 };
+    int page_size{ 10 };
+    
+private:
+    int page{ 0 };
+    int visible{ 0 };
+    int selected{ -1 };
+    bool desc{ false };
+    
+    void fill(const std::function<void()>& cb)
+    {
+        if (cb)
+            cb();
+        else if ($beforePopulate)
+            $beforePopulate();
+        
+        visible = 0;
+        for (int i = 0; i < page_size; i++)
+        {
+            int pos = page * page_size + i;
+            T* pojo = pos < total ? $fetch(desc ? total - 1 - pos : pos) : nullptr;
+            if (pojo)
+                visible++;
+            $populate(i, pojo);
+        }
+    }
+public:
+    void select(int idx)
+    {
+        selected = idx;
+    }
+    
+    bool isDesc()
+    {
+        return desc;
+    }
+    
+    void toggleDesc()
+    {
+        desc = !desc;
+        pageTo(0);
+    }
+    
+    // the backend would be asked for the newer records, the page is refilled
+    bool fetchUpdate()
+    {
+        fill(nullptr);
+        if ($afterPopulate)
+            $afterPopulate(selected < visible ? selected : -1);
+        return true;
+    }
+    
+    // with cb (called instead of $beforePopulate), $afterPopulate is left to the caller
+    bool pageTo(int idx, std::function<void()> cb = nullptr)
+    {
+        if (idx < 0 || idx > getPageCount())
+            return false;
+        
+        page = idx;
+        selected = -1;
+        fill(cb);
+        if (!cb && $afterPopulate)
+            $afterPopulate(-1);
+        return true;
+    }
+    
+    bool prevOrLoad()
+    {
+        return page != 0 && pageTo(page - 1);
+    }
+    
+    // the backend would be asked for more past the last page
+    bool nextOrLoad()
+    {
+        return page != getPageCount() && pageTo(page + 1);
+    }
+    
+    // the last page
+    int getPageCount()
+    {
+        return total == 0 ? 0 : (total - 1) / page_size;
+    }
+    
+    int getPage()
+    {
+        return page;
+    }
+    
+    int getPageSize()
+    {
+        return page_size;
+    }
+    
+    int getSelectedIdx()
+    {
+        return selected;
+    }
+    
+    int getVisibleCount()
+    {
+        return visible;
+    }
+    
+    int size()
+    {
+        return total;
+    }
+};
+
+} // coreds
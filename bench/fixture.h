@@ -0,0 +1,67 @@
+// The records and rows shared by the benches, served from a generated file
+// (see ui::FixedSource).
+
+#pragma once
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include <coreds/nana/ui.h>
+
+struct Item
+{
+    int64_t id;
+    int qty;
+    char name[20];
+};
+
+template <typename P>
+struct ItemFields : P
+{
+    nana::label name_{ *this, "" };
+    nana::label qty_{ *this, "" };
+    
+    ItemFields(nana::widget& owner) : P(owner, "margin=[2,5] <name_><qty_ weight=60>")
+    {
+        this->place["name_"] << name_.transparent(true);
+        this->place["qty_"] << qty_.text_align(nana::align::right).transparent(true);
+        this->collocate();
+    }
+    
+    // ScrollList
+    void update(Item* pojo)
+    {
+        name_.caption(pojo ? pojo->name : "");
+        qty_.caption(pojo ? std::to_string(pojo->qty) : "");
+    }
+    
+    // Pager
+    void update(Item* pojo, int64_t ts)
+    {
+        update(pojo);
+    }
+};
+
+typedef ItemFields<ui::BgPanel> ItemRow;
+// no graphics of its own, so that a layered RowHighlight shows through
+typedef ItemFields<ui::Panel> ItemCell;
+
+// writes count records to path
+static bool generate(const char* path, int count)
+{
+    std::FILE* f = std::fopen(path, "wb");
+    if (!f)
+        return false;
+    
+    Item item;
+    for (int i = 0; i < count; i++)
+    {
+        std::memset(&item, 0, sizeof(item));
+        item.id = i;
+        item.qty = (i * 7919) % 1000;
+        std::snprintf(item.name, sizeof(item.name), "item %d", i);
+        std::fwrite(&item, sizeof(item), 1, f);
+    }
+    return 0 == std::fclose(f);
+}
@@ -0,0 +1,298 @@
+// Replays input against two Pagers over a generated mapped file, one paging it
+// directly (see ui::attach) and one through a fake PojoStore (see
+// fake/coreds/pstore.h), and a w$::Input, then reports the per-event handling
+// time and repaints. Exits non-zero when an event goes over the budget, so the
+// replay_gate target (run under Xvfb) fails on a slowdown.
+//
+//   replay_bench [--events file] [--budget micros] [--repaints n] [--records n]
+//           [--highlight bg|layered] [--script browse|cursor]
+//   replay_bench --record file    (interactive, saves the events on close)
+//
+// Without --events a deterministic built-in script is replayed. The cursor one
+// only moves the selection within a page, so that --repaints bounds what a
+// cursor move repaints: the labels of the row it leaves and of the row it
+// enters (the two stripes), plus the rows themselves with the bg highlight.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <coreds/nana/pager.h>
+#include <coreds/nana/mapped.h>
+#include <coreds/nana/replay.h>
+
+#include "fixture.h"
+
+// PojoStore's backing type, unused by the fake store
+struct ItemTable
+{
+
+};
+
+template <typename W>
+struct ItemPager : ui::Pager<Item, ItemTable, W>
+{
+    ItemPager(nana::widget& owner, bool layered) :
+        ui::Pager<Item, ItemTable, W>(owner, nullptr, 0xF3F3F3, 0xF9F9F9, layered)
+    {
+        
+    }
+    
+    // pages through the fake store instead of attaching the source
+    void useStore(ui::FixedSource<Item>& source)
+    {
+        auto& store = this->store;
+        store.$fetch = [&source](int idx) {
+            return source.get(idx);
+        };
+        store.$beforePopulate = this->$beforePopulate;
+        store.$populate = [this](int idx, Item* pojo) {
+            this->populate(idx, pojo, 0);
+        };
+        store.$afterPopulate = [this](int selectedIdx) {
+            afterPopulate(selectedIdx);
+        };
+        store.total = source.size();
+        store.page_size = this->size();
+    }
+protected:
+    void selectForUpdate(int idx) override
+    {
+        
+    }
+    void beforePopulate() override
+    {
+        
+    }
+    void afterPopulate(int selectedIdx) override
+    {
+        this->select(selectedIdx);
+    }
+};
+
+static void add(std::vector<ui::InputEvent>& out, ui::InputEvent::Kind kind, const char* target,
+        int key, bool ctrl = false, bool shift = false)
+{
+    out.emplace_back();
+    auto& e = out.back();
+    e.kind = kind;
+    e.target = target;
+    e.key = key;
+    e.ctrl = ctrl;
+    e.shift = shift;
+}
+
+static void label(std::vector<ui::InputEvent>& out, const char* target, const char* cmd_target)
+{
+    out.emplace_back();
+    auto& e = out.back();
+    e.kind = ui::InputEvent::Kind::LABEL;
+    e.target = target;
+    e.command = static_cast<int>(nana::label::command::click);
+    e.detail = cmd_target;
+}
+
+// the paths users complain about: key repeat, page flips, range selection, type-ahead, sorting
+static void browse(std::vector<ui::InputEvent>& out, const char* target, const char* nav)
+{
+    typedef ui::InputEvent::Kind Kind;
+    for (int i = 0; i < 200; i++)
+        add(out, Kind::KEY_PRESS, target, nana::keyboard::os_arrow_down);
+    for (int i = 0; i < 30; i++)
+        add(out, Kind::KEY_PRESS, target, nana::keyboard::os_arrow_down, false, true);
+    for (int i = 0; i < 50; i++)
+        add(out, Kind::KEY_PRESS, target, nana::keyboard::os_arrow_right);
+    add(out, Kind::KEY_PRESS, target, nana::keyboard::os_arrow_right, true);
+    add(out, Kind::KEY_PRESS, target, nana::keyboard::os_arrow_left, true);
+    for (int i = 0; i < 20; i++)
+        label(out, nav, "6");
+    label(out, nav, "7");
+    label(out, nav, "4");
+    label(out, nav, "3");
+    for (const char* c = "item 4"; *c; c++)
+        add(out, Kind::KEY_CHAR, target, *c);
+    // a local source has a fixed order, the store reverses
+    label(out, nav, "0");
+    add(out, Kind::KEY_PRESS, target, nana::keyboard::space, true);
+}
+
+static std::vector<ui::InputEvent> cursor()
+{
+    std::vector<ui::InputEvent> out;
+    for (int i = 0; i < 10; i++)
+    {
+        for (int j = 0; j < 19; j++)
+            add(out, ui::InputEvent::Kind::KEY_PRESS, "pager", nana::keyboard::os_arrow_down);
+        for (int j = 0; j < 19; j++)
+            add(out, ui::InputEvent::Kind::KEY_PRESS, "pager", nana::keyboard::os_arrow_up);
+    }
+    return out;
+}
+
+static std::vector<ui::InputEvent> script()
+{
+    std::vector<ui::InputEvent> out;
+    browse(out, "pager", "nav");
+    browse(out, "store", "store_nav");
+    for (const char* c = "hello world"; *c; c++)
+        add(out, ui::InputEvent::Kind::KEY_CHAR, "input", *c);
+    return out;
+}
+
+static void count(ui::Replayer& replayer, ItemRow& row)
+{
+    replayer.count(row);
+    replayer.count(row.name_);
+    replayer.count(row.qty_);
+}
+
+static void count(ui::Replayer& replayer, ItemCell& row)
+{
+    replayer.count(row.name_);
+    replayer.count(row.qty_);
+}
+
+template <typename W>
+static int run(ui::FixedSource<Item>& source, const std::vector<ui::InputEvent>& events,
+        const std::string& record_path, bool layered, int64_t budget, int max_repaints)
+{
+    ui::RootForm form({ 0, 0, 800, 600 });
+    auto& body = form.coalesceResize();
+    nana::place place{ body };
+    place.div("vert margin=5 <input_ weight=30><<vert <nav_ weight=24><pager_>><vert <store_nav_ weight=24><store_>>>");
+    
+    const char* links = "<target=\"0\">sort</> <target=\"4\">first</> <target=\"5\">prev</> "
+            "<target=\"6\">next</> <target=\"7\">last</> <target=\"3\">refresh</>";
+    ui::w$::Input input(body, nullptr, "search", ui::fonts::get(10));
+    nana::label nav(body, links);
+    nana::label store_nav(body, links);
+    ItemPager<W> pager(body, layered);
+    ItemPager<W> store(body, layered);
+    
+    ui::Recorder recorder;
+    for (auto p : { &pager, &store })
+    {
+        p->$text = [](const Item& pojo, std::string& out) {
+            out += pojo.name;
+        };
+        p->events().key_press(p->$navigate);
+        p->events().key_char(p->$typeAhead);
+    }
+    if (record_path.empty())
+    {
+        nav.add_format_listener(pager.$onLabelEvent);
+        store_nav.add_format_listener(store.$onLabelEvent);
+    }
+    else
+    {
+        nav.add_format_listener(recorder.label("nav", pager.$onLabelEvent));
+        store_nav.add_format_listener(recorder.label("store_nav", store.$onLabelEvent));
+        recorder.watch(pager, "pager");
+        recorder.watch(store, "store");
+        recorder.watch(input.$, "input");
+    }
+    nav.format(true);
+    store_nav.format(true);
+    
+    place["input_"] << input;
+    place["nav_"] << nav;
+    place["pager_"] << pager;
+    place["store_nav_"] << store_nav;
+    place["store_"] << store;
+    place.collocate();
+    
+    pager.collocate(20);
+    ui::attach(pager, source);
+    pager.pageTo(0);
+    
+    store.collocate(20);
+    store.useStore(source);
+    store.pageTo(0);
+    
+    form.show();
+    
+    if (!record_path.empty())
+    {
+        recorder.start();
+        nana::exec();
+        recorder.stop();
+        return recorder.save(record_path) ? 0 : 2;
+    }
+    
+    ui::Replayer replayer;
+    replayer.target(pager, "pager");
+    replayer.target(input.$, "input");
+    replayer.target(store, "store");
+    replayer.label("nav", pager.$onLabelEvent);
+    replayer.label("store_nav", store.$onLabelEvent);
+    for (auto p : { &pager, &store })
+    {
+        for (int i = 0; i < p->size(); i++)
+            count(replayer, *p->item(i));
+    }
+    
+    bool passed = false;
+    replayer.play(events, [&]() {
+        replayer.report(stdout);
+        passed = replayer.check(budget, max_repaints);
+        if (!passed)
+            std::fprintf(stderr, "FAILED: an event went over %lld us or %d repaints\n",
+                    static_cast<long long>(budget), max_repaints);
+        form.close();
+    });
+    nana::exec();
+    
+    return passed ? 0 : 1;
+}
+
+int main(int argc, char* argv[])
+{
+    std::string events_path;
+    std::string record_path;
+    int64_t budget = 16000;
+    int max_repaints = -1;
+    int records = 100000;
+    bool layered = false;
+    bool cursor_only = false;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (0 == std::strcmp(argv[i], "--events"))
+            events_path = argv[i + 1];
+        else if (0 == std::strcmp(argv[i], "--record"))
+            record_path = argv[i + 1];
+        else if (0 == std::strcmp(argv[i], "--budget"))
+            budget = std::atoll(argv[i + 1]);
+        else if (0 == std::strcmp(argv[i], "--repaints"))
+            max_repaints = std::atoi(argv[i + 1]);
+        else if (0 == std::strcmp(argv[i], "--records"))
+            records = std::atoi(argv[i + 1]);
+        else if (0 == std::strcmp(argv[i], "--highlight"))
+            layered = 0 == std::strcmp(argv[i + 1], "layered");
+        else if (0 == std::strcmp(argv[i], "--script"))
+            cursor_only = 0 == std::strcmp(argv[i + 1], "cursor");
+    }
+    
+    std::vector<ui::InputEvent> events;
+    if (events_path.empty())
+        events = cursor_only ? cursor() : script();
+    else if (!ui::Recorder::load(events_path, events))
+    {
+        std::fprintf(stderr, "Could not load %s\n", events_path.c_str());
+        return 2;
+    }
+    
+    const char* data_path = "replay_bench.dat";
+    ui::FixedSource<Item> source;
+    if (!generate(data_path, records) || !source.open(data_path))
+    {
+        std::fprintf(stderr, "Could not create %s\n", data_path);
+        return 2;
+    }
+    
+    
+    int rc = layered ? run<ItemCell>(source, events, record_path, true, budget, max_repaints) :
+            run<ItemRow>(source, events, record_path, false, budget, max_repaints);
+    std::remove(data_path);
+    return rc;
+}
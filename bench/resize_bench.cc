@@ -0,0 +1,107 @@
+// Drags the corner of a RootForm (a new size every couple of millis, like a
+// window manager does) over a ScrollList of 100k records, timing each frame:
+// the coalesced layout (RootForm::layoutMicros) plus flushing its repaints.
+// Exits non-zero unless the p99 frame fits the frame budget (60 fps by
+// default), for the resize_gate target.
+//
+//   resize_bench [--frame micros] [--steps n]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <coreds/nana/mapped.h>
+
+#include "fixture.h"
+
+int main(int argc, char* argv[])
+{
+    int64_t frame = 16667;
+    int steps = 1000;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (0 == std::strcmp(argv[i], "--frame"))
+            frame = std::atoll(argv[i + 1]);
+        else if (0 == std::strcmp(argv[i], "--steps"))
+            steps = std::atoi(argv[i + 1]);
+    }
+    
+    const char* data_path = "resize_bench.dat";
+    ui::FixedSource<Item> source;
+    if (!generate(data_path, 100000) || !source.open(data_path))
+    {
+        std::fprintf(stderr, "Could not create %s\n", data_path);
+        return 2;
+    }
+    
+    ui::RootForm form({ 0, 0, 640, 480 });
+    auto& body = form.coalesceResize();
+    nana::place place{ body };
+    place.div("vert margin=5 <input_ weight=30><list_>");
+    
+    ui::w$::Input input(body, nullptr, "search", ui::fonts::get(10));
+    ui::ScrollList<Item, ItemRow> list(body, 24);
+    list.$fetch = [&source](int idx) {
+        return source.get(idx);
+    };
+    place["input_"] << input;
+    place["list_"] << list;
+    place.collocate();
+    list.size(source.size());
+    
+    std::vector<int64_t> frames;
+    form.$afterLayout = [&]() {
+        auto start = std::chrono::steady_clock::now();
+        nana::API::update_window(form);
+        auto paint = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+        frames.push_back(form.layoutMicros() + paint.count());
+    };
+    
+    form.show();
+    
+    // out to 1280x960 and back, 4px per step
+    int step = 0;
+    nana::timer drag;
+    nana::timer settle;
+    settle.interval(100);
+    settle.elapse([&]() {
+        settle.stop();
+        form.close();
+    });
+    drag.interval(2);
+    drag.elapse([&]() {
+        if (step == steps)
+        {
+            drag.stop();
+            // the last coalesced layout is a frame away
+            settle.start();
+            return;
+        }
+        
+        int phase = step % 320;
+        int offset = 4 * (phase < 160 ? phase : 320 - phase);
+        form.size({ static_cast<unsigned>(640 + offset), static_cast<unsigned>(480 + offset * 3 / 4) });
+        step++;
+    });
+    drag.start();
+    nana::exec();
+    
+    std::remove(data_path);
+    
+    if (frames.empty())
+    {
+        std::fprintf(stderr, "FAILED: no layout ran\n");
+        return 1;
+    }
+    
+    std::sort(frames.begin(), frames.end());
+    int64_t p99 = frames[static_cast<size_t>(0.99 * (frames.size() - 1))];
+    std::printf("steps: %d, layouts: %d, p50 frame: %lld us, p99 frame: %lld us, worst: %lld us, budget: %lld us\n",
+            steps, static_cast<int>(frames.size()),
+            static_cast<long long>(frames[frames.size() / 2]), static_cast<long long>(p99),
+            static_cast<long long>(frames.back()), static_cast<long long>(frame));
+    return p99 <= frame ? 0 : 1;
+}
@@ -0,0 +1,93 @@
+// Wheel-scrolls a ScrollList over 100k records (served from a generated
+// mapped file) through the Replayer, flushing the repaints after each tick so
+// that every timed event is a full frame. Exits non-zero unless the p99 frame
+// fits the frame budget (60 fps by default), for the scroll_gate target.
+//
+//   scroll_bench [--frame micros] [--records n] [--ticks n]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <coreds/nana/mapped.h>
+#include <coreds/nana/replay.h>
+
+#include "fixture.h"
+
+static void wheel(std::vector<ui::InputEvent>& out, bool upwards)
+{
+    out.emplace_back();
+    auto& e = out.back();
+    e.kind = ui::InputEvent::Kind::WHEEL;
+    e.target = "list";
+    e.upwards = upwards;
+    e.distance = 120;
+}
+
+int main(int argc, char* argv[])
+{
+    int64_t frame = 16667;
+    int records = 100000;
+    int ticks = 2000;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (0 == std::strcmp(argv[i], "--frame"))
+            frame = std::atoll(argv[i + 1]);
+        else if (0 == std::strcmp(argv[i], "--records"))
+            records = std::atoi(argv[i + 1]);
+        else if (0 == std::strcmp(argv[i], "--ticks"))
+            ticks = std::atoi(argv[i + 1]);
+    }
+    
+    const char* data_path = "scroll_bench.dat";
+    ui::FixedSource<Item> source;
+    if (!generate(data_path, records) || !source.open(data_path))
+    {
+        std::fprintf(stderr, "Could not create %s\n", data_path);
+        return 2;
+    }
+    
+    // down, then back up a quarter of the way, changing direction now and then
+    std::vector<ui::InputEvent> events;
+    for (int i = 0; i < ticks; i++)
+        wheel(events, i % 50 == 49);
+    for (int i = 0; i < ticks / 4; i++)
+        wheel(events, true);
+    
+    ui::RootForm form({ 0, 0, 800, 600 });
+    auto& body = form.coalesceResize();
+    nana::place place{ body };
+    place.div("margin=5 <list_>");
+    
+    ui::ScrollList<Item, ItemRow> list(body, 24);
+    list.$fetch = [&source](int idx) {
+        return source.get(idx);
+    };
+    place["list_"] << list;
+    place.collocate();
+    list.size(source.size());
+    
+    form.show();
+    
+    ui::Replayer replayer;
+    replayer.target(list, "list");
+    replayer.$settle = [&list]() {
+        nana::API::update_window(list);
+    };
+    
+    bool passed = false;
+    replayer.play(events, [&]() {
+        replayer.report(stdout);
+        auto p99 = replayer.percentile(0.99);
+        std::printf("records: %d, p99 frame: %lld us (%.0f fps), budget: %lld us\n",
+                source.size(), static_cast<long long>(p99), p99 ? 1e6 / p99 : 0.0,
+                static_cast<long long>(frame));
+        passed = p99 <= frame;
+        form.close();
+    });
+    nana::exec();
+    
+    std::remove(data_path);
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,28 @@
+#!/usr/bin/env python3
+"""Runs a ui bench under Xvfb and writes the stamp only when it passes, so
+that a bench exiting non-zero (e.g. over its frame budget) fails the build.
+
+  xvfb_gate.py <stamp> <bench> [args...]
+"""
+
+import subprocess
+import sys
+
+
+def main(argv):
+    if len(argv) < 3:
+        sys.stderr.write(__doc__)
+        return 2
+
+    stamp, cmd = argv[1], argv[2:]
+    rc = subprocess.call(["xvfb-run", "-a", "-s", "-screen 0 1280x1024x24"] + cmd)
+    if rc != 0:
+        return rc
+
+    with open(stamp, "w"):
+        pass
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
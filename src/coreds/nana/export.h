@@ -0,0 +1,210 @@
+#pragma once
+
+#include <cstdio>
+#include <type_traits>
+
+#include "ui.h"
+
+namespace ui {
+
+// streams a dataset to a file on a worker thread in bounded batches, reporting on a MsgPanel
+template <typename T>
+struct Exporter
+{
+    // fills out with up to limit records starting at offset and returns the count (0 when done).
+    // Runs on the worker thread, so it must not touch the PojoStore or the widgets.
+    // The destructor cancels and waits for the current call to return.
+    std::function<int(int offset, int limit, std::vector<T>& out)> $fetch;
+    // appends the encoded record to out (see csv and raw), runs on the worker thread
+    std::function<void(const T& pojo, std::string& out)> $format;
+    // written before the records (e.g. the csv column names)
+    std::string header;
+    
+private:
+    struct State
+    {
+        std::atomic<bool> cancelled{ false };
+        std::atomic<bool> done{ false };
+        std::atomic<int> written{ 0 };
+        std::mutex mutex;
+        std::string error;
+    };
+    std::shared_ptr<State> state;
+    std::thread worker;
+    std::string path;
+    nana::timer poll;
+    MsgPanel* panel{ nullptr };
+    
+    static void run(std::shared_ptr<State> state,
+            std::function<int(int offset, int limit, std::vector<T>& out)> fetch,
+            std::function<void(const T& pojo, std::string& out)> format,
+            std::string path, std::string header, int batch_size, size_t buffer_size)
+    {
+        std::FILE* f = std::fopen(path.c_str(), "wb");
+        if (!f)
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->error = "Could not open " + path;
+            state->done = true;
+            return;
+        }
+        
+        bool ok = true;
+        std::string buf;
+        buf.reserve(buffer_size * 2);
+        buf += header;
+        
+        std::vector<T> batch;
+        batch.reserve(batch_size);
+        
+        int offset = 0;
+        while (ok && !state->cancelled)
+        {
+            batch.clear();
+            int count = fetch(offset, batch_size, batch);
+            if (count <= 0)
+                break;
+            
+            // what was filled, whatever count says
+            for (auto& pojo : batch)
+            {
+                format(pojo, buf);
+                if (buf.size() < buffer_size)
+                    continue;
+                
+                ok = buf.size() == std::fwrite(buf.data(), 1, buf.size(), f);
+                buf.clear();
+                if (!ok)
+                    break;
+            }
+            
+            offset += count;
+            state->written = offset;
+        }
+        
+        if (ok && !buf.empty())
+            ok = buf.size() == std::fwrite(buf.data(), 1, buf.size(), f);
+        
+        ok = 0 == std::fclose(f) && ok;
+        
+        if (state->cancelled || !ok)
+            std::remove(path.c_str());
+        
+        if (!ok)
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->error = "Could not write " + path;
+        }
+        state->done = true;
+    }
+    void onPoll()
+    {
+        auto s = state;
+        if (!s)
+        {
+            poll.stop();
+            return;
+        }
+        
+        if (!s->done)
+        {
+            if (panel)
+                panel->update("Exporting ... " + std::to_string(s->written) + " records", Msg::$WARNING);
+            return;
+        }
+        
+        poll.stop();
+        state.reset();
+        if (!panel)
+            return;
+        
+        std::string error;
+        {
+            std::lock_guard<std::mutex> lock(s->mutex);
+            error = s->error;
+        }
+        
+        if (!error.empty())
+            panel->update(error, Msg::$ERROR);
+        else if (s->cancelled)
+            panel->update("Export cancelled.", Msg::$WARNING);
+        else
+            panel->update("Exported " + std::to_string(s->written) + " records to " + path, Msg::$SUCCESS);
+    }
+public:
+    Exporter()
+    {
+        poll.interval(200);
+        poll.elapse([this]() {
+            onPoll();
+        });
+    }
+    ~Exporter()
+    {
+        // the worker calls $fetch/$format, whose captures usually go away with the owner
+        cancel();
+        if (worker.joinable())
+            worker.join();
+    }
+    
+    // false if an export is already running
+    bool start(const std::string& path, MsgPanel* progress = nullptr,
+            int batch_size = 5000, size_t buffer_size = 1 << 20)
+    {
+        if (state || !$fetch || !$format)
+            return false;
+        
+        // the previous export is done (see onPoll)
+        if (worker.joinable())
+            worker.join();
+        
+        this->path = path;
+        panel = progress;
+        state = std::make_shared<State>();
+        worker = std::thread(run, state, $fetch, $format, path, header, batch_size, buffer_size);
+        poll.start();
+        return true;
+    }
+    
+    void cancel()
+    {
+        if (state)
+            state->cancelled = true;
+    }
+    
+    bool running()
+    {
+        return state != nullptr;
+    }
+    
+    // appends a csv cell (quoted when needed) and a comma or newline
+    static void csv(std::string& out, const std::string& cell, bool last = false)
+    {
+        if (std::string::npos == cell.find_first_of(",\"\r\n"))
+        {
+            out += cell;
+        }
+        else
+        {
+            out += '"';
+            for (char c : cell)
+            {
+                if (c == '"')
+                    out += '"';
+                out += c;
+            }
+            out += '"';
+        }
+        out += last ? '\n' : ',';
+    }
+    
+    // appends the bytes of a trivially copyable value
+    template <typename R>
+    static void raw(std::string& out, const R& value)
+    {
+        static_assert(std::is_trivially_copyable<R>::value, "raw needs a trivially copyable value");
+        out.append(reinterpret_cast<const char*>(&value), sizeof(R));
+    }
+};
+
+} // ui
@@ -0,0 +1,299 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+#ifdef WIN32
+// keeps std::min/std::max usable after windows.h
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ui {
+
+// read-only, mapped copy-on-write so that writes to the views never reach the file
+struct MappedFile
+{
+private:
+    char* data_{ nullptr };
+    size_t size_{ 0 };
+#ifdef WIN32
+    HANDLE file{ INVALID_HANDLE_VALUE };
+    HANDLE mapping{ nullptr };
+#endif
+public:
+    MappedFile()
+    {
+        
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile()
+    {
+        close();
+    }
+    
+    bool open(const std::string& path)
+    {
+        close();
+#ifdef WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+        
+        LARGE_INTEGER sz;
+        if (!GetFileSizeEx(file, &sz))
+        {
+            close();
+            return false;
+        }
+        
+        // a 0-byte file cannot be mapped
+        if (0 == sz.QuadPart)
+        {
+            close();
+            return true;
+        }
+        
+        mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+        if (!mapping)
+        {
+            close();
+            return false;
+        }
+        
+        data_ = static_cast<char*>(MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0));
+        if (!data_)
+        {
+            close();
+            return false;
+        }
+        size_ = static_cast<size_t>(sz.QuadPart);
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd == -1)
+            return false;
+        
+        struct stat st;
+        if (0 != fstat(fd, &st))
+        {
+            ::close(fd);
+            return false;
+        }
+        
+        // a 0-byte file cannot be mapped
+        if (0 == st.st_size)
+        {
+            ::close(fd);
+            return true;
+        }
+        
+        void* p = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        // the mapping keeps its own reference to the file
+        ::close(fd);
+        if (p == MAP_FAILED)
+            return false;
+        
+        data_ = static_cast<char*>(p);
+        size_ = st.st_size;
+#endif
+        return true;
+    }
+    
+    void close()
+    {
+#ifdef WIN32
+        if (data_)
+            UnmapViewOfFile(data_);
+        if (mapping)
+            CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (data_)
+            munmap(data_, size_);
+#endif
+        data_ = nullptr;
+        size_ = 0;
+    }
+    
+    char* data()
+    {
+        return data_;
+    }
+    
+    size_t size()
+    {
+        return size_;
+    }
+};
+
+// fixed-stride records of T served in place from a mapped file, after an optional header
+template <typename T>
+struct FixedSource
+{
+    static_assert(std::is_trivially_copyable<T>::value, "records must be trivially copyable");
+    
+private:
+    MappedFile file;
+    size_t header{ 0 };
+    int count{ 0 };
+public:
+    // maps the file again to pick up appended records, header_bytes must keep T aligned
+    bool open(const std::string& path, size_t header_bytes = 0)
+    {
+        count = 0;
+        header = header_bytes;
+        // the records are read in place, the mapping itself is page-aligned
+        if (0 != header % alignof(T) || !file.open(path) || file.size() < header)
+            return false;
+        
+        count = static_cast<int>((file.size() - header) / sizeof(T));
+        return true;
+    }
+    
+    int size()
+    {
+        return count;
+    }
+    
+    T* get(int idx)
+    {
+        return idx < 0 || idx >= count ? nullptr : reinterpret_cast<T*>(file.data() + header) + idx;
+    }
+    
+    int getPageCount(int page_size)
+    {
+        // the last page, following PojoStore's convention
+        return count == 0 ? 0 : (count - 1) / page_size;
+    }
+};
+
+// variable-size records from a mapped data file, located through a mapped index of uint64 offsets
+// (V is constructed from (const char* data, size_t size))
+template <typename V>
+struct IndexedSource
+{
+private:
+    MappedFile data;
+    MappedFile index;
+    int count{ 0 };
+    
+    uint64_t offset(int idx)
+    {
+        return reinterpret_cast<const uint64_t*>(index.data())[idx];
+    }
+public:
+    bool open(const std::string& data_path, const std::string& index_path)
+    {
+        count = 0;
+        if (!data.open(data_path) || !index.open(index_path))
+            return false;
+        
+        count = static_cast<int>(index.size() / sizeof(uint64_t));
+        return true;
+    }
+    
+    int size()
+    {
+        return count;
+    }
+    
+    // an empty view when out of range or when the index is corrupt
+    V get(int idx)
+    {
+        if (idx < 0 || idx >= count)
+            return V(nullptr, 0);
+        
+        uint64_t start = offset(idx);
+        uint64_t end = idx + 1 == count ? data.size() : offset(idx + 1);
+        if (start > end || end > data.size())
+            return V(nullptr, 0);
+        
+        return V(data.data() + start, static_cast<size_t>(end - start));
+    }
+    
+    int getPageCount(int page_size)
+    {
+        return count == 0 ? 0 : (count - 1) / page_size;
+    }
+};
+
+// fills the pager's rows with the page (nullptr past the last record), returns the number shown
+template <typename P, typename T>
+int populate(P& pager, FixedSource<T>& source, int page, int64_t ts = 0)
+{
+    const int len = pager.size();
+    const int first = page * len;
+    int visible = 0;
+    for (int i = 0; i < len; i++)
+    {
+        auto pojo = source.get(first + i);
+        if (pojo)
+            visible++;
+        pager.populate(i, pojo, ts);
+    }
+    return visible;
+}
+
+// serves the pager's pages from the source instead of its PojoStore (both must outlive that use)
+template <typename P, typename T>
+void attach(P& pager, FixedSource<T>& source)
+{
+    pager.$loadPage = [&pager, &source](int page) {
+        return populate(pager, source, page);
+    };
+    pager.$lastPage = [&pager, &source]() {
+        return source.getPageCount(pager.size());
+    };
+    pager.$fetch = [&source](int key) {
+        return source.get(key);
+    };
+}
+
+// same for the views, each constructed into the pager's arena (T can be V itself)
+template <typename P, typename V>
+int populate(P& pager, IndexedSource<V>& source, int page, int64_t ts = 0)
+{
+    const int len = pager.size();
+    const int first = page * len;
+    int visible = 0;
+    for (int i = 0; i < len; i++)
+    {
+        auto pojo = first + i < source.size() ? pager.make(source.get(first + i)) : nullptr;
+        if (pojo)
+            visible++;
+        pager.populate(i, pojo, ts);
+    }
+    return visible;
+}
+
+template <typename P, typename V>
+void attach(P& pager, IndexedSource<V>& source)
+{
+    pager.$loadPage = [&pager, &source](int page) {
+        return populate(pager, source, page);
+    };
+    pager.$lastPage = [&pager, &source]() {
+        return source.getPageCount(pager.size());
+    };
+    pager.$fetch = [&pager, &source](int key) {
+        return key >= 0 && key < source.size() ? pager.make(source.get(key)) : nullptr;
+    };
+}
+
+} // ui
@@ -1,23 +1,258 @@
 #pragma once
 
+#include <cctype>
+#include <iterator>
+#include <new>
+#include <type_traits>
+
 #include <coreds/pstore.h>
 #include "ui.h"
 
 namespace ui {
 
+// chunked arena for the pojos of a page window (see Pager::make), clear() keeps the chunks
+template <typename T>
+struct Arena
+{
+private:
+    typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type Slot;
+    std::vector<std::unique_ptr<Slot[]>> chunks;
+    const int chunk_size;
+    int count{ 0 };
+    
+    void destroy(std::true_type)
+    {
+        
+    }
+    void destroy(std::false_type)
+    {
+        for (int i = 0; i < count; i++)
+            reinterpret_cast<T*>(&chunks[i / chunk_size][i % chunk_size])->~T();
+    }
+public:
+    Arena(int chunk_size = 64): chunk_size(chunk_size)
+    {
+        
+    }
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    ~Arena()
+    {
+        clear();
+    }
+    
+    template <typename... Args>
+    T* make(Args&&... args)
+    {
+        size_t c = count / chunk_size;
+        if (c == chunks.size())
+            chunks.emplace_back(new Slot[chunk_size]);
+        
+        auto p = new (&chunks[c][count % chunk_size]) T(std::forward<Args>(args)...);
+        count++;
+        return p;
+    }
+    
+    void clear()
+    {
+        destroy(std::is_trivially_destructible<T>());
+        count = 0;
+    }
+    
+    void shrink()
+    {
+        size_t used = (count + chunk_size - 1) / chunk_size;
+        if (used < chunks.size())
+            chunks.resize(used);
+    }
+    
+    int size()
+    {
+        return count;
+    }
+    
+    int capacity()
+    {
+        return chunks.size() * chunk_size;
+    }
+};
+
+// incremental find over the text of the records a Pager has loaded, each char narrows the last matches
+struct TypeAhead
+{
+    bool substring{ false };
+    // a char typed after this pause starts a new query
+    unsigned timeout_ms{ 1000 };
+    // the max records indexed, the farthest from the latest one are dropped first
+    size_t limit{ 1000 };
+    
+private:
+    typedef std::chrono::steady_clock clock;
+    
+    std::map<int, std::string> texts;
+    // the matching keys for each query length
+    std::vector<std::vector<int>> matches;
+    std::string query;
+    clock::time_point last;
+    
+    bool match(const std::string& text, size_t len)
+    {
+        if (substring)
+            return text.end() != std::search(text.begin(), text.end(), query.begin(), query.begin() + len);
+        
+        return 0 == text.compare(0, len, query, 0, len);
+    }
+    bool match(const std::string& text)
+    {
+        return match(text, query.size());
+    }
+    // keeps the matches of each query length in step with a key (re)indexed mid-query
+    void rematch(int key, const std::string& text)
+    {
+        for (size_t i = 0; i < matches.size(); i++)
+        {
+            auto& keys = matches[i];
+            auto it = std::lower_bound(keys.begin(), keys.end(), key);
+            bool found = it != keys.end() && *it == key;
+            if (match(text, i + 1))
+            {
+                if (!found)
+                    keys.insert(it, key);
+            }
+            else if (found)
+            {
+                keys.erase(it);
+            }
+        }
+    }
+    void unmatch(int key)
+    {
+        for (auto& keys : matches)
+        {
+            auto it = std::lower_bound(keys.begin(), keys.end(), key);
+            if (it != keys.end() && *it == key)
+                keys.erase(it);
+        }
+    }
+    int first()
+    {
+        return matches.empty() || matches.back().empty() ? -1 : matches.back().front();
+    }
+public:
+    void index(int key, const std::string& text)
+    {
+        auto& lower = texts[key];
+        lower.assign(text);
+        for (auto& c : lower)
+            c = std::tolower(static_cast<unsigned char>(c));
+        if (!matches.empty())
+            rematch(key, lower);
+        
+        while (texts.size() > limit)
+        {
+            auto head = texts.begin();
+            auto tail = std::prev(texts.end());
+            auto farthest = key - head->first > tail->first - key ? head : tail;
+            unmatch(farthest->first);
+            texts.erase(farthest);
+        }
+    }
+    
+    void clear()
+    {
+        texts.clear();
+        reset();
+    }
+    
+    void reset()
+    {
+        query.clear();
+        matches.clear();
+    }
+    
+    // the first key matching the query or -1
+    int append(char c)
+    {
+        auto now = clock::now();
+        if (now - last > std::chrono::milliseconds(timeout_ms))
+            reset();
+        last = now;
+        
+        query += std::tolower(static_cast<unsigned char>(c));
+        
+        std::vector<int> next;
+        if (matches.empty())
+        {
+            for (auto& e : texts)
+            {
+                if (match(e.second))
+                    next.push_back(e.first);
+            }
+        }
+        else
+        {
+            for (int key : matches.back())
+            {
+                auto it = texts.find(key);
+                if (it != texts.end() && match(it->second))
+                    next.push_back(key);
+            }
+        }
+        matches.push_back(std::move(next));
+        return first();
+    }
+    
+    // drops the last char, returns the first key matching the rest or -1
+    int pop()
+    {
+        if (query.empty())
+            return -1;
+        
+        last = clock::now();
+        query.pop_back();
+        matches.pop_back();
+        return first();
+    }
+    
+    const std::string& getQuery()
+    {
+        return query;
+    }
+};
+
 template <typename T, typename F, typename W>
 struct Pager : ui::Panel
 {
     coreds::PojoStore<T, F> store;
+    // keyed by the record's position across pages (page * size() + idx),
+    // so it is cleared whenever the store's contents change (see onBeforePopulate)
+    Selection selection;
+    // resolves the records outside the current page, nullptr when not loaded
+    // (see batch and typeAhead)
+    std::function<T*(int key)> $fetch;
+    // receives the pojos of every selected record in one call (see batch)
+    std::function<void(const std::vector<T*>& pojos)> $onBatch;
+    // the text of a record that type-ahead matches against
+    std::function<void(const T& pojo, std::string& out)> $text;
+    TypeAhead finder;
+    // serves the pages from a local source instead of the store when set (see
+    // ui::attach in mapped.h): fills the rows and returns the number shown
+    std::function<int(int page)> $loadPage;
+    // the last page of that source
+    std::function<int()> $lastPage;
     
+    // kept as std::function for PojoStore's callback param (the delegate fits inline)
     std::function<void()> $beforePopulate{
-        std::bind(&Pager::beforePopulate, this)
+        Delegate<void()>::bind<Pager, &Pager::onBeforePopulate>(this)
     };
-    std::function<void(const nana::arg_keyboard& arg)> $navigate{
-        std::bind(&Pager::navigate, this, std::placeholders::_1)
+    Delegate<void(const nana::arg_keyboard& arg)> $navigate{
+        Delegate<void(const nana::arg_keyboard& arg)>::bind<Pager, &Pager::navigate>(this)
     };
-    std::function<void(nana::label::command cmd, const std::string& target)> $onLabelEvent{
-        std::bind(&Pager::onLabelEvent, this, std::placeholders::_1, std::placeholders::_2)
+    Delegate<void(nana::label::command cmd, const std::string& target)> $onLabelEvent{
+        Delegate<void(nana::label::command cmd, const std::string& target)>::bind<Pager, &Pager::onLabelEvent>(this)
+    };
+    Delegate<void(const nana::arg_keyboard& arg)> $typeAhead{
+        Delegate<void(const nana::arg_keyboard& arg)>::bind<Pager, &Pager::typeAhead>(this)
     };
 protected:
     virtual void selectForUpdate(int idx) = 0;
@@ -26,15 +261,148 @@ protected:
 private:
     std::forward_list<W> items;
     std::vector<W*> array;
-    nana::color selected_bg;
+    std::vector<T*> pojos;
+    RowHighlight highlight;
     int selected_idx{ -1 };
+    std::string text_buf;
+    // the page whose loaded neighbourhood was last indexed for type-ahead
+    int indexed_page{ -1 };
+    // with $loadPage
+    int page_{ 0 };
+    int visible_{ 0 };
+    // the pojos allocated through make: the front one backs the window shown
+    // (or the one before it), the other takes the allocations
+    Arena<T> arenas[2];
+    int front{ 0 };
+    // a page flip the pager asked the store for is pending (the store may load first),
+    // its population is not a change of contents
+    bool requested{ false };
+    
+    void onBeforePopulate()
+    {
+        // any other population (a refresh, records pushed by the server) can
+        // shift what the positions refer to
+        if (!requested && !$loadPage)
+            invalidateKeys();
+        requested = false;
+        
+        // anything allocated since the last swap is the window about to be shown
+        // (decoded ahead by the store) or the one shown now (decoded while
+        // populating), so the window before that can go
+        if (arenas[front ^ 1].size() != 0)
+        {
+            front ^= 1;
+            arenas[front ^ 1].clear();
+        }
+        beforePopulate();
+    }
+    int keyOf(int idx)
+    {
+        return getPage() * static_cast<int>(array.size()) + idx;
+    }
+    int lastPage()
+    {
+        return $loadPage ? $lastPage() : store.getPageCount();
+    }
+    int visibleCount()
+    {
+        return $loadPage ? visible_ : store.getVisibleCount();
+    }
+    // populates the page, afterPopulate is left to the caller
+    void fill(int page)
+    {
+        if (!$loadPage)
+        {
+            requested = true;
+            if (!store.pageTo(page, $beforePopulate))
+                requested = false;
+            return;
+        }
+        
+        $beforePopulate();
+        // before the rows are populated, for keyOf
+        page_ = page;
+        visible_ = $loadPage(page);
+    }
+    void syncMarks()
+    {
+        for (int i = 0, len = array.size(); i < len; i++)
+            highlight.mark(i, pojos[i] && selection.contains(keyOf(i)) ? array[i]->handle() : nullptr);
+    }
+    void index(int key, T* pojo)
+    {
+        text_buf.clear();
+        $text(*pojo, text_buf);
+        finder.index(key, text_buf);
+    }
+    // indexes the records $fetch resolves around the current page (the
+    // store's loaded ones, or the local source's), not just the rows shown
+    void indexLoaded()
+    {
+        if (!$text || !$fetch || indexed_page == getPage())
+            return;
+        
+        indexed_page = getPage();
+        int center = keyOf(0);
+        std::vector<std::pair<int, T*>> found;
+        bool up = true;
+        bool down = true;
+        for (int d = 0; (up || down) && found.size() < finder.limit; d++)
+        {
+            T* pojo = down ? $fetch(center + d) : nullptr;
+            if (pojo)
+                found.emplace_back(center + d, pojo);
+            else
+                down = false;
+            
+            pojo = up && center - d > 0 ? $fetch(center - d - 1) : nullptr;
+            if (pojo)
+                found.emplace_back(center - d - 1, pojo);
+            else
+                up = false;
+        }
+        
+        // the nearest last, the index drops the farthest from the latest
+        for (auto it = found.rbegin(); it != found.rend(); ++it)
+            index(it->first, it->second);
+    }
+    void cursorTo(int idx, bool extend)
+    {
+        select(idx);
+        selection.pick(keyOf(idx), false, extend);
+        syncMarks();
+    }
+    void toggleDesc()
+    {
+        // a local source has a fixed order
+        if ($loadPage)
+            return;
+        
+        invalidateKeys();
+        store.toggleDesc();
+    }
+    void fetchUpdate()
+    {
+        invalidateKeys();
+        if (!$loadPage)
+        {
+            store.fetchUpdate();
+            return;
+        }
+        
+        fill(page_);
+        afterPopulate(selected_idx < visible_ ? selected_idx : -1);
+    }
     
 public:    
-    Pager(nana::widget& owner, const char* layout = nullptr, unsigned selected_bg = 0xF3F3F3):
+    Pager(nana::widget& owner, const char* layout = nullptr, unsigned selected_bg = 0xF3F3F3, unsigned hover_bg = 0xF9F9F9,
+            bool layered = false):
         ui::Panel(owner, layout ? layout : "margin=[5,0] <items_ vert>"),
-        selected_bg(nana::color_rgb(selected_bg))
+        highlight(*this, nana::color_rgb(selected_bg), nana::color_rgb(hover_bg), layered)
     {
-        
+        events().focus([this](const nana::arg_focus& arg) {
+            highlight.focus(arg.getting);
+        });
     }
     
     int getSelectedIdx()
@@ -42,16 +410,76 @@ public:
         return selected_idx;
     }
     
+    // allocates a pojo for the decode callbacks (the store's fetch or a local
+    // source's page), released two windows later
+    template <typename... Args>
+    T* make(Args&&... args)
+    {
+        return arenas[front ^ 1].make(std::forward<Args>(args)...);
+    }
+    
+    int getPage()
+    {
+        return $loadPage ? page_ : store.getPage();
+    }
+    
+    // with a local source, any page (e.g. the last) is reached in O(1)
+    void pageTo(int page)
+    {
+        if (!$loadPage)
+        {
+            requested = true;
+            if (!store.pageTo(page))
+                requested = false;
+            return;
+        }
+        
+        if (page < 0 || page > lastPage())
+            return;
+        
+        fill(page);
+        afterPopulate(-1);
+    }
+    
+    void prev()
+    {
+        if (!$loadPage)
+        {
+            requested = true;
+            if (!store.prevOrLoad())
+                requested = false;
+        }
+        else if (page_ != 0)
+            pageTo(page_ - 1);
+    }
+    
+    void next()
+    {
+        if (!$loadPage)
+        {
+            requested = true;
+            if (!store.nextOrLoad())
+                requested = false;
+        }
+        else if (page_ != lastPage())
+            pageTo(page_ + 1);
+    }
+    
     void collocate(int pageSize = 10)
     {
+        highlight.reserve(array.size() + pageSize);
         for (int i = 0; i < pageSize; i++)
         {
             items.emplace_front(*this);
             place["items_"] << items.front();
             array.push_back(&items.front());
+            pojos.push_back(nullptr);
+            highlight.track(items.front());
         }
         
-        place.collocate();
+        // the rows are new fields
+        Panel::invalidate();
+        Panel::collocate();
     }
     
     int size()
@@ -66,41 +494,79 @@ public:
     
     void populate(int idx, T* pojo, int64_t ts)
     {
+        pojos[idx] = pojo;
         array[idx]->update(pojo, ts);
+        highlight.mark(idx, pojo && selection.contains(keyOf(idx)) ? array[idx]->handle() : nullptr);
+        
+        if (pojo && $text)
+            index(keyOf(idx), pojo);
     }
     
     bool trySelect(int idx)
     {
-        int prev_idx = selected_idx;
-        if (idx == prev_idx)
-            return false;
-        
-        if (idx == -1)
-        {
-            // deselect
-            selected_idx = idx;
-            array[prev_idx]->bgcolor(nana::colors::white);
-            return true;
-        }
-        
-        if (idx < 0 || idx >= array.size())
+        if (idx == selected_idx || idx < -1 || idx >= static_cast<int>(array.size()))
             return false;
         
         selected_idx = idx;
-        
-        if (prev_idx != -1)
-            array[prev_idx]->bgcolor(nana::colors::white);
-        
-        array[idx]->bgcolor(selected_bg);
+        highlight.select(idx == -1 ? nullptr : array[idx]->handle());
         return true;
     }
     
     virtual void select(int idx)
     {
-        if (trySelect(idx))
+        if (trySelect(idx) && !$loadPage)
             store.select(idx);
     }
     
+    // shift/ctrl semantics (see Selection::pick), e.g. from a row click
+    void pick(int idx, bool ctrl, bool shift)
+    {
+        if (idx < 0 || idx >= visibleCount())
+            return;
+        
+        select(idx);
+        selection.pick(keyOf(idx), ctrl, shift);
+        syncMarks();
+    }
+    
+    void selectAll(int count)
+    {
+        selection.add(0, count);
+        syncMarks();
+    }
+    
+    void deselectAll()
+    {
+        selection.clear();
+        syncMarks();
+    }
+    
+    // drops the selection and the type-ahead index, which are keyed by position
+    void invalidateKeys()
+    {
+        selection.clear();
+        syncMarks();
+        finder.clear();
+        indexed_page = -1;
+    }
+    
+    // hands the selected pojos to $onBatch, the ones off the page resolved through $fetch
+    void batch()
+    {
+        if (!$onBatch)
+            return;
+        
+        int first = keyOf(0);
+        int last = first + array.size();
+        std::vector<T*> out;
+        selection.forEach([this, &out, first, last](int key) {
+            T* pojo = key >= first && key < last ? pojos[key - first] : ($fetch ? $fetch(key) : nullptr);
+            if (pojo)
+                out.push_back(pojo);
+        });
+        $onBatch(out);
+    }
+    
     void onLabelEvent(nana::label::command cmd, const std::string& target)
     {
         if (nana::label::command::click != cmd)
@@ -111,88 +577,135 @@ public:
         {
             case 0:
             case 1:
-                store.toggleDesc();
+                toggleDesc();
                 break;
             case 3: // refresh
-                store.fetchUpdate();
+                fetchUpdate();
                 break;
             case 4:
-                store.pageTo(0);
+                pageTo(0);
                 break;
             case 5:
-                store.prevOrLoad();
+                prev();
                 break;
             case 6:
-                store.nextOrLoad();
+                next();
                 break;
             case 7:
-                store.pageTo(store.getPageCount());
+                pageTo(lastPage());
+                break;
+        }
+    }
+    
+    // key is the position across pages
+    void jumpTo(int key)
+    {
+        int page = key / static_cast<int>(array.size());
+        int idx = key % static_cast<int>(array.size());
+        if (page == getPage())
+        {
+            // keeps the multi-selection
+            select(idx);
+            return;
+        }
+        
+        fill(page);
+        afterPopulate(idx);
+    }
+    
+    // bind to key_char, only ascii is matched
+    void typeAhead(const nana::arg_keyboard& arg)
+    {
+        int key;
+        switch (arg.key)
+        {
+            case nana::keyboard::escape:
+                finder.reset();
+                return;
+            case nana::keyboard::backspace:
+                key = finder.pop();
+                break;
+            default:
+                if (arg.ctrl || arg.key < 32 || arg.key > 126)
+                    return;
+                // a leading space is left to navigate
+                if (arg.key == nana::keyboard::space && finder.getQuery().empty())
+                    return;
+                indexLoaded();
+                key = finder.append(static_cast<char>(arg.key));
                 break;
         }
+        
+        if (key != -1)
+            jumpTo(key);
     }
     
     void navigate(const nana::arg_keyboard& arg)
     {
-        int idx = store.getSelectedIdx();
+        // keep idle work out of the way while keys are held down
+        if (ui::root)
+            ui::root->idle.touch();
+        
+        int idx = $loadPage ? selected_idx : store.getSelectedIdx();
         switch (arg.key)
         {
             case nana::keyboard::os_arrow_up:
                 if (arg.ctrl)
                 {
-                    select(0);
+                    cursorTo(0, arg.shift);
                 }
                 else if (-1 == idx)
                 {
-                    select(store.getVisibleCount() - 1);
+                    cursorTo(visibleCount() - 1, arg.shift);
                 }
                 else if (0 != idx)
                 {
-                    select(idx - 1);
+                    cursorTo(idx - 1, arg.shift);
                 }
-                else if (0 != store.getPage())
+                else if (0 != getPage())
                 {
-                    store.pageTo(store.getPage() - 1, $beforePopulate);
-                    afterPopulate(store.getVisibleCount() - 1);
+                    fill(getPage() - 1);
+                    afterPopulate(visibleCount() - 1);
                 }
                 break;
             case nana::keyboard::os_arrow_down:
                 if (arg.ctrl)
                 {
-                    select(store.getVisibleCount() - 1);
+                    cursorTo(visibleCount() - 1, arg.shift);
                 }
                 else if (-1 == idx)
                 {
-                    select(0);
+                    cursorTo(0, arg.shift);
                 }
-                else if (++idx != store.getVisibleCount())
+                else if (++idx != visibleCount())
                 {
-                    select(idx);
+                    cursorTo(idx, arg.shift);
                 }
-                else if (store.getPageCount() != store.getPage())
+                else if (lastPage() != getPage())
                 {
-                    store.pageTo(store.getPage() + 1, $beforePopulate);
+                    fill(getPage() + 1);
                     afterPopulate(0);
                 }
                 break;
             case nana::keyboard::os_arrow_left:
                 if (arg.ctrl)
-                    store.pageTo(0);
+                    pageTo(0);
                 else
-                    store.prevOrLoad();
+                    prev();
                 break;
             case nana::keyboard::os_arrow_right:
                 if (arg.ctrl)
-                    store.pageTo(store.getPageCount());
+                    pageTo(lastPage());
                 else
-                    store.nextOrLoad();
+                    next();
                 break;
             case nana::keyboard::space:
                 if (arg.ctrl && arg.shift)
                     selectForUpdate(idx);
                 else if (arg.ctrl)
-                    store.fetchUpdate();
+                    fetchUpdate();
                 else if (arg.shift)
-                    store.toggleDesc();
+                    toggleDesc();
                 break;
         }
     }
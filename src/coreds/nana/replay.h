@@ -0,0 +1,405 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <forward_list>
+#include <memory>
+#include <unordered_map>
+
+#include "ui.h"
+
+namespace ui {
+
+// an input event addressed to a named target, to be replayed on a freshly built window tree
+struct InputEvent
+{
+    enum class Kind : uint8_t
+    {
+        KEY_PRESS,
+        KEY_CHAR,
+        MOUSE_DOWN,
+        MOUSE_UP,
+        CLICK,
+        WHEEL,
+        LABEL
+    };
+    
+    // since the recording started
+    int64_t micros{ 0 };
+    Kind kind{ Kind::KEY_PRESS };
+    std::string target;
+    int key{ 0 };
+    bool ctrl{ false };
+    bool shift{ false };
+    bool alt{ false };
+    int x{ 0 };
+    int y{ 0 };
+    bool upwards{ false };
+    unsigned distance{ 0 };
+    // the label command and its target
+    int command{ 0 };
+    std::string detail;
+};
+
+// records the input events of the watched widgets, named without whitespace (see Replayer)
+struct Recorder
+{
+    typedef std::function<void(nana::label::command cmd, const std::string& target)> LabelListener;
+    
+    std::vector<InputEvent> events;
+    
+private:
+    std::chrono::steady_clock::time_point origin;
+    bool recording{ false };
+    
+    InputEvent* next(InputEvent::Kind kind, const std::string& target)
+    {
+        if (!recording)
+            return nullptr;
+        
+        events.emplace_back();
+        auto& e = events.back();
+        e.micros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - origin).count();
+        e.kind = kind;
+        e.target = target;
+        return &e;
+    }
+    void key(InputEvent::Kind kind, const std::string& target, const nana::arg_keyboard& arg)
+    {
+        if (auto e = next(kind, target))
+        {
+            e->key = arg.key;
+            e->ctrl = arg.ctrl;
+            e->shift = arg.shift;
+            e->alt = arg.alt;
+        }
+    }
+    void mouse(InputEvent::Kind kind, const std::string& target, const nana::arg_mouse& arg)
+    {
+        if (auto e = next(kind, target))
+        {
+            e->x = arg.pos.x;
+            e->y = arg.pos.y;
+            e->ctrl = arg.ctrl;
+            e->shift = arg.shift;
+            e->alt = arg.alt;
+        }
+    }
+public:
+    void start()
+    {
+        events.clear();
+        origin = std::chrono::steady_clock::now();
+        recording = true;
+    }
+    
+    void stop()
+    {
+        recording = false;
+    }
+    
+    void watch(nana::widget& w, const std::string& name)
+    {
+        auto& ev = w.events();
+        ev.key_press.connect_front([this, name](const nana::arg_keyboard& arg) {
+            key(InputEvent::Kind::KEY_PRESS, name, arg);
+        });
+        ev.key_char.connect_front([this, name](const nana::arg_keyboard& arg) {
+            key(InputEvent::Kind::KEY_CHAR, name, arg);
+        });
+        ev.mouse_down.connect_front([this, name](const nana::arg_mouse& arg) {
+            mouse(InputEvent::Kind::MOUSE_DOWN, name, arg);
+        });
+        ev.mouse_up.connect_front([this, name](const nana::arg_mouse& arg) {
+            mouse(InputEvent::Kind::MOUSE_UP, name, arg);
+        });
+        ev.click.connect_front([this, name](const nana::arg_click& arg) {
+            next(InputEvent::Kind::CLICK, name);
+        });
+        ev.mouse_wheel.connect_front([this, name](const nana::arg_wheel& arg) {
+            mouse(InputEvent::Kind::WHEEL, name, arg);
+            if (recording)
+            {
+                events.back().upwards = arg.upwards;
+                events.back().distance = arg.distance;
+            }
+        });
+    }
+    
+    // wraps the listener, pass the returned one to add_format_listener
+    LabelListener label(const std::string& name, LabelListener listener)
+    {
+        return [this, name, listener](nana::label::command cmd, const std::string& target) {
+            if (auto e = next(InputEvent::Kind::LABEL, name))
+            {
+                e->command = static_cast<int>(cmd);
+                e->detail = target;
+            }
+            listener(cmd, target);
+        };
+    }
+    
+    // one event per line, the label target last (it may contain spaces)
+    bool save(const std::string& path)
+    {
+        std::FILE* f = std::fopen(path.c_str(), "w");
+        if (!f)
+            return false;
+        
+        for (auto& e : events)
+        {
+            std::fprintf(f, "%lld %d %s %d %d %d %d %d %d %d %u %d %s\n",
+                    static_cast<long long>(e.micros), static_cast<int>(e.kind), e.target.c_str(),
+                    e.key, e.ctrl, e.shift, e.alt, e.x, e.y, e.upwards, e.distance, e.command, e.detail.c_str());
+        }
+        return 0 == std::fclose(f);
+    }
+    
+    static bool load(const std::string& path, std::vector<InputEvent>& out)
+    {
+        std::FILE* f = std::fopen(path.c_str(), "r");
+        if (!f)
+            return false;
+        
+        char target[256];
+        char line[1024];
+        bool ok = true;
+        while (std::fgets(line, sizeof(line), f))
+        {
+            InputEvent e;
+            long long micros;
+            int kind, ctrl, shift, alt, upwards, consumed = 0;
+            if (12 != std::sscanf(line, "%lld %d %255s %d %d %d %d %d %d %d %u %d %n",
+                    &micros, &kind, target, &e.key, &ctrl, &shift, &alt, &e.x, &e.y, &upwards, &e.distance, &e.command, &consumed) ||
+                    0 == consumed)
+            {
+                ok = false;
+                break;
+            }
+            
+            e.micros = micros;
+            e.kind = static_cast<InputEvent::Kind>(kind);
+            e.target = target;
+            e.ctrl = 0 != ctrl;
+            e.shift = 0 != shift;
+            e.alt = 0 != alt;
+            e.upwards = 0 != upwards;
+            e.detail.assign(line + consumed);
+            while (!e.detail.empty() && (e.detail.back() == '\n' || e.detail.back() == '\r'))
+                e.detail.pop_back();
+            
+            out.push_back(std::move(e));
+        }
+        std::fclose(f);
+        return ok;
+    }
+};
+
+// replays recorded events against the named targets, timing each and counting the repaints meanwhile
+struct Replayer
+{
+    typedef std::function<void(nana::label::command cmd, const std::string& target)> LabelListener;
+    
+    struct Result
+    {
+        const InputEvent* event;
+        int64_t micros;
+        int repaints;
+    };
+    std::vector<Result> results;
+    // called after each event and timed with it, e.g. to flush the pending
+    // repaints (nana::API::update_window) so that the time is a frame time
+    std::function<void()> $settle;
+    
+private:
+    struct Target
+    {
+        nana::window wd{ nullptr };
+        LabelListener listener;
+    };
+    std::unordered_map<std::string, Target> targets;
+    std::forward_list<nana::drawing> counters;
+    std::shared_ptr<int> repaints{ std::make_shared<int>(0) };
+    nana::timer kickoff;
+    
+    template <typename A>
+    void fill(A& arg, nana::window wd, nana::event_code code)
+    {
+        arg.window_handle = wd;
+        arg.evt_code = code;
+    }
+    void dispatch(const InputEvent& e, Target& t)
+    {
+        switch (e.kind)
+        {
+            case InputEvent::Kind::KEY_PRESS:
+            case InputEvent::Kind::KEY_CHAR:
+            {
+                auto code = e.kind == InputEvent::Kind::KEY_PRESS ? nana::event_code::key_press : nana::event_code::key_char;
+                nana::arg_keyboard arg;
+                fill(arg, t.wd, code);
+                arg.key = static_cast<wchar_t>(e.key);
+                arg.ignore = false;
+                arg.ctrl = e.ctrl;
+                arg.shift = e.shift;
+                arg.alt = e.alt;
+                nana::API::emit_event(code, t.wd, arg);
+                break;
+            }
+            case InputEvent::Kind::MOUSE_DOWN:
+            case InputEvent::Kind::MOUSE_UP:
+            case InputEvent::Kind::WHEEL:
+            {
+                auto code = e.kind == InputEvent::Kind::MOUSE_DOWN ? nana::event_code::mouse_down :
+                        e.kind == InputEvent::Kind::MOUSE_UP ? nana::event_code::mouse_up : nana::event_code::mouse_wheel;
+                nana::arg_wheel arg;
+                fill(arg, t.wd, code);
+                arg.pos = { e.x, e.y };
+                arg.button = nana::mouse::left_button;
+                arg.left_button = e.kind == InputEvent::Kind::MOUSE_DOWN;
+                arg.mid_button = false;
+                arg.right_button = false;
+                arg.ctrl = e.ctrl;
+                arg.shift = e.shift;
+                arg.alt = e.alt;
+                arg.which = nana::arg_wheel::wheel::vertical;
+                arg.upwards = e.upwards;
+                arg.distance = e.distance;
+                if (e.kind == InputEvent::Kind::WHEEL)
+                    nana::API::emit_event(code, t.wd, arg);
+                else
+                    nana::API::emit_event(code, t.wd, static_cast<const nana::arg_mouse&>(arg));
+                break;
+            }
+            case InputEvent::Kind::CLICK:
+            {
+                nana::arg_click arg;
+                arg.window_handle = t.wd;
+                arg.mouse_args = nullptr;
+                nana::API::emit_event(nana::event_code::click, t.wd, arg);
+                break;
+            }
+            case InputEvent::Kind::LABEL:
+                if (t.listener)
+                    t.listener(static_cast<nana::label::command>(e.command), e.detail);
+                break;
+        }
+    }
+public:
+    // also counts its repaints (widgets with their own graphics only)
+    void target(nana::widget& w, const std::string& name)
+    {
+        targets[name].wd = w.handle();
+        count(w);
+    }
+    
+    void count(nana::widget& w)
+    {
+        auto counter = repaints;
+        counters.emplace_front(w.handle());
+        counters.front().draw([counter](nana::paint::graphics& graph) {
+            ++*counter;
+        });
+    }
+    
+    void label(const std::string& name, LabelListener listener)
+    {
+        targets[name].listener = std::move(listener);
+    }
+    
+    // back to back and synchronously, events for unknown targets are skipped
+    void run(const std::vector<InputEvent>& events)
+    {
+        results.clear();
+        results.reserve(events.size());
+        for (auto& e : events)
+        {
+            auto it = targets.find(e.target);
+            if (it == targets.end())
+                continue;
+            
+            int before = *repaints;
+            auto start = std::chrono::steady_clock::now();
+            dispatch(e, it->second);
+            if ($settle)
+                $settle();
+            auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+            
+            results.push_back({ &e, elapsed.count(), *repaints - before });
+        }
+    }
+    
+    // runs the events once the event loop is up (call before nana::exec), then done
+    void play(const std::vector<InputEvent>& events, std::function<void()> done)
+    {
+        kickoff.interval(1);
+        kickoff.elapse([this, &events, done]() {
+            kickoff.stop();
+            run(events);
+            if (done)
+                done();
+        });
+        kickoff.start();
+    }
+    
+    int64_t worst()
+    {
+        int64_t max = 0;
+        for (auto& r : results)
+            max = std::max(max, r.micros);
+        return max;
+    }
+    
+    int64_t percentile(double p)
+    {
+        if (results.empty())
+            return 0;
+        
+        std::vector<int64_t> sorted;
+        sorted.reserve(results.size());
+        for (auto& r : results)
+            sorted.push_back(r.micros);
+        std::sort(sorted.begin(), sorted.end());
+        
+        size_t idx = static_cast<size_t>(p * (sorted.size() - 1));
+        return sorted[std::min(idx, sorted.size() - 1)];
+    }
+    
+    int totalRepaints()
+    {
+        int total = 0;
+        for (auto& r : results)
+            total += r.repaints;
+        return total;
+    }
+    
+    // false if any event went over the budget or over max_repaints (-1 for no limit)
+    bool check(int64_t budget_micros, int max_repaints = -1)
+    {
+        for (auto& r : results)
+        {
+            if (r.micros > budget_micros || (max_repaints != -1 && r.repaints > max_repaints))
+                return false;
+        }
+        return true;
+    }
+    
+    void report(std::FILE* out)
+    {
+        for (auto& r : results)
+        {
+            std::fprintf(out, "%s %d %d %lld us %d repaints\n",
+                    r.event->target.c_str(), static_cast<int>(r.event->kind), r.event->key,
+                    static_cast<long long>(r.micros), r.repaints);
+        }
+        std::fprintf(out, "events: %d, p50: %lld us, p99: %lld us, worst: %lld us, repaints: %d\n",
+                static_cast<int>(results.size()),
+                static_cast<long long>(percentile(0.5)),
+                static_cast<long long>(percentile(0.99)),
+                static_cast<long long>(worst()),
+                totalRepaints());
+    }
+};
+
+} // ui
@@ -2,13 +2,27 @@
 
 #include <vector>
 #include <forward_list>
+#include <map>
+#include <tuple>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <functional>
+#include <memory>
+#include <typeindex>
 
 #include <coreds/util.h>
 
+#include <cstdio>
+
 #include <nana/gui/wvl.hpp>
+#include <nana/gui/timer.hpp>
 #include <nana/gui/widgets/label.hpp>
 #include <nana/gui/widgets/panel.hpp>
 #include <nana/gui/widgets/picture.hpp>
+#include <nana/gui/widgets/scroll.hpp>
 #include <nana/gui/widgets/textbox.hpp>
 
 namespace ui {
@@ -65,6 +79,43 @@ const MsgColors MsgColors::DEFAULT {
     0x777777
 };
 
+// binds a member function without std::bind's allocation, small enough for std::function to keep inline
+template <typename S>
+struct Delegate;
+
+template <typename R, typename... Args>
+struct Delegate<R(Args...)>
+{
+private:
+    void* obj{ nullptr };
+    R (*fn)(void*, Args...){ nullptr };
+    
+    template <typename C, R (C::*M)(Args...)>
+    static R thunk(void* obj, Args... args)
+    {
+        return (static_cast<C*>(obj)->*M)(std::forward<Args>(args)...);
+    }
+public:
+    template <typename C, R (C::*M)(Args...)>
+    static Delegate bind(C* obj)
+    {
+        Delegate d;
+        d.obj = obj;
+        d.fn = &thunk<C, M>;
+        return d;
+    }
+    
+    R operator()(Args... args) const
+    {
+        return fn(obj, std::forward<Args>(args)...);
+    }
+    
+    explicit operator bool() const
+    {
+        return fn != nullptr;
+    }
+};
+
 // not in the widget api
 inline void visible(nana::widget& w, bool on)
 {
@@ -146,14 +197,436 @@ inline uint8_t operator& (uint8_t a, WindowFlags b)
     return a & static_cast<uint8_t>(b);
 }
 
+// runs low-priority tasks in short slices between events, a task returns true while it has work left
+struct IdleScheduler
+{
+    enum class Priority : uint8_t
+    {
+        HIGH,
+        NORMAL,
+        LOW
+    };
+    
+    typedef std::function<bool()> Task;
+    
+private:
+    typedef std::chrono::steady_clock clock;
+    
+    struct Entry
+    {
+        int id;
+        Priority priority;
+        Task fn;
+    };
+    std::vector<Entry> tasks;
+    nana::timer timer;
+    int next_id{ 0 };
+    std::chrono::microseconds slice;
+    clock::time_point deferred_until;
+    clock::time_point window_start{ clock::now() };
+    std::chrono::microseconds window_used{ 0 };
+    std::chrono::microseconds last_used{ 0 };
+    
+    int indexOf(int id)
+    {
+        for (int i = 0, len = tasks.size(); i < len; i++)
+        {
+            if (id == tasks[i].id)
+                return i;
+        }
+        return -1;
+    }
+    void account(clock::time_point start, clock::time_point end)
+    {
+        window_used += std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+        if (end - window_start < std::chrono::seconds(1))
+            return;
+        
+        last_used = window_used;
+        window_used = std::chrono::microseconds::zero();
+        window_start = end;
+    }
+    void run()
+    {
+        auto start = clock::now();
+        if (start < deferred_until)
+            return;
+        
+        auto deadline = start + slice;
+        auto now = start;
+        while (!tasks.empty() && now < deadline)
+        {
+            // tasks are kept sorted by priority, the first is the most urgent
+            auto id = tasks.front().id;
+            auto fn = tasks.front().fn;
+            bool more = fn();
+            
+            // the task may have cancelled itself or posted new ones
+            int idx = indexOf(id);
+            if (idx != -1)
+            {
+                auto e = std::move(tasks[idx]);
+                tasks.erase(tasks.begin() + idx);
+                if (more)
+                    insert(std::move(e));
+            }
+            
+            now = clock::now();
+        }
+        
+        account(start, now);
+        
+        if (tasks.empty())
+            stop();
+    }
+    void stop()
+    {
+        timer.stop();
+        // the partial window is the last one, it ends now
+        last_used = window_used;
+        window_used = std::chrono::microseconds::zero();
+        window_start = clock::now();
+    }
+    void insert(Entry e)
+    {
+        // after the tasks of the same priority (round-robin)
+        auto it = tasks.begin();
+        while (it != tasks.end() && it->priority <= e.priority)
+            ++it;
+        tasks.insert(it, std::move(e));
+    }
+public:
+    IdleScheduler(unsigned interval = 15, unsigned slice_ms = 5): slice(slice_ms * 1000)
+    {
+        timer.interval(interval);
+        timer.elapse([this]() {
+            run();
+        });
+    }
+    
+    // returns the id for cancel()
+    int post(Task task, Priority priority = Priority::NORMAL)
+    {
+        int id = ++next_id;
+        insert({ id, priority, std::move(task) });
+        timer.start();
+        return id;
+    }
+    
+    bool cancel(int id)
+    {
+        int idx = indexOf(id);
+        if (idx == -1)
+            return false;
+        
+        tasks.erase(tasks.begin() + idx);
+        return true;
+    }
+    
+    // skips the idle slices for the next millis, e.g. from key repeat handlers
+    void touch(unsigned millis = 100)
+    {
+        deferred_until = clock::now() + std::chrono::milliseconds(millis);
+    }
+    
+    void clear()
+    {
+        tasks.clear();
+        stop();
+    }
+    
+    int pending()
+    {
+        return tasks.size();
+    }
+    
+    // the millis spent running tasks during the last second (0 once idle for longer)
+    unsigned usage()
+    {
+        if (tasks.empty() && clock::now() - window_start >= std::chrono::seconds(1))
+            return 0;
+        
+        return last_used.count() / 1000;
+    }
+};
+
+// thread-safe queue of calls to run on a root form's ui thread, posts after it is gone are dropped
+struct Mailbox
+{
+private:
+    std::mutex mutex;
+    std::vector<std::function<void()>> queue;
+    std::atomic<bool> pending{ false };
+    bool open{ true };
+public:
+    bool post(std::function<void()> fn)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!open)
+            return false;
+        
+        queue.push_back(std::move(fn));
+        pending = true;
+        return true;
+    }
+    
+    // called on the owning ui thread
+    void drain()
+    {
+        if (!pending)
+            return;
+        
+        std::vector<std::function<void()>> batch;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            batch.swap(queue);
+            pending = false;
+        }
+        for (auto& fn : batch)
+            fn();
+    }
+    
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        open = false;
+        queue.clear();
+    }
+};
+
+namespace fonts {
+// defined below, with the default args
+inline const nana::paint::font& get(double size, bool bold, bool italic);
+} // fonts
+
+// Generates the w$ heights and layouts from the font metrics at the root's scale
+// (see RootForm::metrics) instead of the tables tuned for 96 dpi.
+// scale() re-applies them to the tracked widgets and owner fields in one pass.
+struct Metrics
+{
+    enum class Kind : uint8_t
+    {
+        INPUT,
+        LABEL,
+        CHECKBOX
+    };
+    
+    struct Entry
+    {
+        int height;
+        std::string input;
+        std::string label;
+        std::string checkbox;
+    };
+    
+private:
+    struct Live
+    {
+        nana::window wd;
+        nana::place* place;
+        Kind kind;
+        int size;
+        // the widget showing the text, re-typefaced on a scale change
+        nana::widget* text;
+        bool bold;
+        bool italic;
+        // restores the state a re-div resets (e.g. field display)
+        std::function<void()> reapply;
+    };
+    // an owner's field sized to the sum of the heights of its widgets
+    struct Flex
+    {
+        nana::window wd;
+        nana::place* place;
+        std::string field;
+        std::vector<int> sizes;
+        int extra;
+    };
+    struct Tracked
+    {
+        std::vector<Live> live;
+        std::vector<Flex> flex;
+    };
+    // by size and scale percent, kept since deferred widgets hold the layout strings
+    std::map<std::pair<int, int>, std::unique_ptr<Entry>> cache;
+    // shared with the destroy handlers, which can outlive this
+    std::shared_ptr<Tracked> tracked{ std::make_shared<Tracked>() };
+    double scale_{ 1.0 };
+    bool enabled_{ false };
+    
+    Entry compute(int size)
+    {
+        nana::paint::graphics graph({ 1, 1 });
+        graph.typeface(nana::paint::font("", size * scale_));
+        
+        const int text_h = graph.text_extent_size("Wj").height;
+        const int height = (text_h * 3 + 1) / 2;
+        const int margin = std::max(0, (height - text_h) / 2 - 1);
+        const int icon_margin = std::max(0, (height - 16) / 2);
+        
+        char buf[192];
+        Entry e;
+        e.height = height;
+        
+        std::snprintf(buf, sizeof(buf), "margin=[%d,1,1,1]<_>", margin);
+        e.input = buf;
+        
+        std::snprintf(buf, sizeof(buf), "margin=[%d,5,0,5]<_>", margin);
+        e.label = buf;
+        
+        std::snprintf(buf, sizeof(buf),
+                "margin=[0,1]<on_ margin=[%d,0,0,0] weight=16><off_ margin=[%d,0,0,0] weight=16><weight=10><_ margin=[%d,0,0,0]>",
+                icon_margin, icon_margin, margin);
+        e.checkbox = buf;
+        
+        return e;
+    }
+    void typeface(Live& l)
+    {
+        if (l.text)
+            l.text->typeface(fonts::get(l.size * scale_, l.bold, l.italic));
+    }
+    void untrackOnDestroy(nana::widget& w)
+    {
+        auto wd = w.handle();
+        std::weak_ptr<Tracked> ref = tracked;
+        w.events().destroy([ref, wd](const nana::arg_destroy& arg) {
+            auto t = ref.lock();
+            if (!t)
+                return;
+            
+            t->live.erase(std::remove_if(t->live.begin(), t->live.end(), [wd](const Live& l) {
+                return l.wd == wd;
+            }), t->live.end());
+            t->flex.erase(std::remove_if(t->flex.begin(), t->flex.end(), [wd](const Flex& f) {
+                return f.wd == wd;
+            }), t->flex.end());
+        });
+    }
+public:
+    void enable(bool on = true)
+    {
+        enabled_ = on;
+    }
+    
+    bool enabled()
+    {
+        return enabled_;
+    }
+    
+    double scale()
+    {
+        return scale_;
+    }
+    
+    // the root's scale over the system dpi (e.g. from the monitor it is on), re-scales the tracked widgets
+    void scale(double factor)
+    {
+        if (factor == scale_)
+            return;
+        
+        scale_ = factor;
+        refresh();
+    }
+    
+    const Entry& get(int size)
+    {
+        auto& e = cache[std::make_pair(size, static_cast<int>(scale_ * 100 + 0.5))];
+        if (!e)
+            e.reset(new Entry(compute(size)));
+        return *e;
+    }
+    
+    const char* layout(Kind kind, int size, int* flex_height)
+    {
+        auto& e = get(size);
+        if (flex_height)
+            *flex_height += e.height;
+        
+        switch (kind)
+        {
+            case Kind::LABEL: return e.label.c_str();
+            case Kind::CHECKBOX: return e.checkbox.c_str();
+            default: return e.input.c_str();
+        }
+    }
+    
+    void track(nana::widget& w, nana::place& place, Kind kind, const nana::paint::font& font,
+            nana::widget* text, std::function<void()> reapply = nullptr)
+    {
+        tracked->live.push_back({ w.handle(), &place, kind, static_cast<int>(font.size()),
+                text, font.bold(), font.italic(), std::move(reapply) });
+        if (scale_ != 1.0)
+            typeface(tracked->live.back());
+        untrackOnDestroy(w);
+    }
+    
+    // sizes the owner's field to extra plus the heights of the widgets of the font sizes
+    // stacked in it (what their flex_height adds up to), again on every refresh
+    void flex(nana::widget& owner, nana::place& place, const std::string& field, std::vector<int> sizes, int extra = 0)
+    {
+        tracked->flex.push_back({ owner.handle(), &place, field, std::move(sizes), extra });
+        untrackOnDestroy(owner);
+    }
+    
+    // re-applies the layouts, typefaces and owner heights at the current scale
+    void refresh()
+    {
+        for (auto& l : tracked->live)
+        {
+            l.place->div(layout(l.kind, l.size, nullptr));
+            typeface(l);
+            l.place->collocate();
+            if (l.reapply)
+                l.reapply();
+        }
+        
+        char buf[32];
+        for (auto& f : tracked->flex)
+        {
+            int weight = f.extra;
+            for (int size : f.sizes)
+                weight += get(size).height;
+            
+            std::snprintf(buf, sizeof(buf), "weight=%d", weight);
+            f.place->modify(f.field.c_str(), buf);
+            f.place->collocate();
+        }
+    }
+};
+
 struct RootForm;
-RootForm* root{ nullptr };
+// the root form of the calling thread, each ui thread has its own
+thread_local RootForm* root{ nullptr };
 
 struct RootForm : nana::form
 {
 private:
     bool closed{ false };
+    nana::timer resize_timer;
+    nana::size resize_pending;
+    std::unique_ptr<nana::panel<false>> body_;
+    std::chrono::microseconds layout_time{ 0 };
+    std::shared_ptr<Mailbox> mailbox_{ std::make_shared<Mailbox>() };
+    nana::timer mail_timer;
+    
+    void flushResize()
+    {
+        resize_timer.stop();
+        
+        // the body's place lays out synchronously on the size change
+        auto start = std::chrono::steady_clock::now();
+        nana::API::window_size(*body_, resize_pending);
+        layout_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+        if ($afterLayout)
+            $afterLayout();
+    }
 public:
+    IdleScheduler idle;
+    Metrics metrics;
+    // called after each coalesced resize is laid out (see layoutMicros)
+    std::function<void()> $afterLayout;
+    
     RootForm(nana::rectangle rect,
             uint8_t flags = uint8_t(WindowFlags::DEFAULT),
             const nana::color& bg = nana::colors::white): nana::form(rect,
@@ -173,21 +646,87 @@ public:
         events().unload([this](const nana::arg_unload& arg) {
             closed = true;
         });
+        mail_timer.interval(15);
+        mail_timer.elapse([this]() {
+            mailbox_->drain();
+        });
+        mail_timer.start();
+    }
+    ~RootForm()
+    {
+        mailbox_->close();
+        if (root == this)
+            root = nullptr;
     }
     bool isClosed()
     {
         return closed;
     }
+    
+    std::shared_ptr<Mailbox> mailbox()
+    {
+        return mailbox_;
+    }
+    
+    // safe to call from any thread
+    bool post(std::function<void()> fn)
+    {
+        return mailbox_->post(std::move(fn));
+    }
+    
+    // a panel filling the form that is resized at most once per frame while the form is being resized
+    // (bind the content's place to it, not to the form)
+    nana::panel<false>& coalesceResize(unsigned frame_ms = 16)
+    {
+        resize_timer.interval(frame_ms);
+        if (body_)
+            return *body_;
+        
+        body_.reset(new nana::panel<false>(*this));
+        nana::API::window_size(*body_, size());
+        
+        resize_timer.elapse([this]() {
+            flushResize();
+        });
+        events().resized([this](const nana::arg_resized& arg) {
+            resize_pending = { arg.width, arg.height };
+            resize_timer.start();
+        });
+        return *body_;
+    }
+    
+    unsigned layoutMicros()
+    {
+        return layout_time.count();
+    }
 };
 
+// the calling thread's metrics, if enabled
+inline Metrics* metrics()
+{
+    return root && root->metrics.enabled() ? &root->metrics : nullptr;
+}
+
+// runs a root window on a new thread with its own event loop, build creates it there
+inline std::thread spawn(std::function<std::unique_ptr<RootForm>()> build)
+{
+    return std::thread([build]() {
+        auto form = build();
+        form->show();
+        nana::exec();
+    });
+}
+
 struct SubForm : nana::form
 {
+    RootForm& owner;
     const bool modal;
-    SubForm(nana::rectangle rect,
+    SubForm(RootForm& owner,
+            nana::rectangle rect,
             const std::string& title = "",
             bool modal = true,
             uint8_t flags = uint8_t(WindowFlags::DECORATION),
-            const nana::color& bg = nana::colors::white): nana::form(*ui::root, rect,
+            const nana::color& bg = nana::colors::white): nana::form(owner, rect,
         nana::appearance(
             0 != (flags & WindowFlags::DECORATION),
             0 != (flags & WindowFlags::TASKBAR),
@@ -197,27 +736,41 @@ struct SubForm : nana::form
             0 != (flags & WindowFlags::MAXIMIZE),
             0 != (flags & WindowFlags::SIZABLE)
         )
-    ), modal(modal)
+    ), owner(owner), modal(modal)
     {
         bgcolor(bg);
         if (!title.empty())
             caption(title);
         events().unload([this](const nana::arg_unload& arg) {
-            if (ui::root->isClosed())
+            if (this->owner.isClosed())
                 return;
             
             arg.cancel = true;
             if (this->modal)
             {
-                nana::API::window_enabled(*root, true);
-                root->focus();
+                nana::API::window_enabled(this->owner, true);
+                this->owner.focus();
             }
             hide();
             onClose();
         });
     }
+    // parented to the calling thread's root form
+    SubForm(nana::rectangle rect,
+            const std::string& title = "",
+            bool modal = true,
+            uint8_t flags = uint8_t(WindowFlags::DECORATION),
+            const nana::color& bg = nana::colors::white):
+        SubForm(*ui::root, rect, title, modal, flags, bg)
+    {
+        
+    }
 protected:
     virtual void onClose() {}
+    // called by SubFormPool before handing out a pooled instance
+    virtual void onReset() {}
+    friend struct SubFormPool;
+    
     int resizeY(int y)
     {
         auto sz = size();
@@ -230,7 +783,7 @@ protected:
         nana::API::move_window(*this, pos);
         show();
         if (modal)
-            nana::API::window_enabled(*root, false);
+            nana::API::window_enabled(owner, false);
     }
     void popTo(nana::window target, int y)
     {
@@ -240,64 +793,206 @@ protected:
     }
 };
 
-struct Place : nana::place
-{
-    Place(nana::widget& owner, const char* layout) : nana::place(owner)
-    {
-        div(layout);
-    }
-};
-
-struct Icon : nana::picture
+// keeps one instance per SubForm type alive, built in idle slices after warm()
+struct SubFormPool
 {
-    Icon(nana::widget& owner, nana::paint::image icon, bool cursor_hand = false) : nana::picture(owner)
+private:
+    struct Entry
     {
-        load(icon);
-        transparent(true);
-        
-        if (!cursor_hand)
-            return;
+        const std::type_index type;
+        const std::function<SubForm*()> factory;
+        std::unique_ptr<SubForm> instance;
         
-        events().mouse_move([this](const nana::arg_mouse& arg) {
-            cursor(nana::cursor::hand);
-        });
+        Entry(std::type_index type, std::function<SubForm*()> factory):
+            type(type), factory(factory)
+        {
+            
+        }
+    };
+    std::vector<Entry> entries;
+    size_t warmed{ 0 };
+    int task_id{ 0 };
+    IdleScheduler* scheduler{ nullptr };
+    
+    Entry* find(std::type_index type)
+    {
+        for (auto& e : entries)
+        {
+            if (e.type == type)
+                return &e;
+        }
+        return nullptr;
     }
-    Icon(nana::widget& owner, const char* icon, bool cursor_hand = false):
-        Icon(owner, nana::paint::image(icon), cursor_hand)
+    SubForm& instance(Entry& e)
     {
-        
+        if (!e.instance)
+            e.instance.reset(e.factory());
+        return *e.instance;
     }
-};
-
-struct DeferredIcon : nana::picture
-{
-    DeferredIcon(nana::paint::image icon, bool cursor_hand = false) : nana::picture()
+    bool warmNext()
     {
-        load(icon);
-        //transparent(true);
+        while (warmed < entries.size() && entries[warmed].instance)
+            warmed++;
         
-        if (!cursor_hand)
-            return;
+        if (warmed == entries.size())
+            return false;
         
-        events().mouse_move([this](const nana::arg_mouse& arg) {
-            cursor(nana::cursor::hand);
-        });
+        instance(entries[warmed++]);
+        return warmed < entries.size();
     }
-protected:
-    void _m_complete_creation() override
+public:
+    ~SubFormPool()
+    {
+        // only if the form that runs the task is still around
+        if (task_id && ui::root && scheduler == &ui::root->idle)
+            scheduler->cancel(task_id);
+    }
+    
+    template <typename S>
+    void add(std::function<S*()> factory)
+    {
+        if (!find(typeid(S)))
+            entries.emplace_back(typeid(S), [factory]() -> SubForm* { return factory(); });
+    }
+    
+    template <typename S>
+    void add()
+    {
+        add<S>([]() { return new S(); });
+    }
+    
+    // false off a ui thread
+    bool warm()
+    {
+        if (!ui::root)
+            return false;
+        
+        if (task_id || warmed == entries.size())
+            return true;
+        
+        scheduler = &ui::root->idle;
+        task_id = scheduler->post([this]() {
+            if (warmNext())
+                return true;
+            
+            task_id = 0;
+            return false;
+        }, IdleScheduler::Priority::LOW);
+        return true;
+    }
+    
+    template <typename S>
+    bool ready()
+    {
+        auto e = find(typeid(S));
+        return e && e->instance;
+    }
+    
+    // built now if not warmed yet, nullptr if the type was not registered
+    template <typename S>
+    S* get(bool reset = true)
+    {
+        auto e = find(typeid(S));
+        if (!e)
+            return nullptr;
+        
+        auto& form = instance(*e);
+        if (reset)
+            form.onReset();
+        
+        return static_cast<S*>(&form);
+    }
+};
+
+struct Place : nana::place
+{
+    Place(nana::widget& owner, const char* layout) : nana::place(owner)
+    {
+        div(layout);
+    }
+};
+
+inline void cursor_hand(const nana::arg_mouse& arg)
+{
+    nana::API::window_cursor(arg.window_handle, nana::cursor::hand);
+}
+
+struct Icon : nana::picture
+{
+    Icon(nana::widget& owner, nana::paint::image icon, bool cursor_hand = false) : nana::picture(owner)
+    {
+        load(icon);
+        transparent(true);
+        
+        if (!cursor_hand)
+            return;
+        
+        events().mouse_move(&ui::cursor_hand);
+    }
+    Icon(nana::widget& owner, const char* icon, bool cursor_hand = false):
+        Icon(owner, nana::paint::image(icon), cursor_hand)
+    {
+        
+    }
+};
+
+struct DeferredIcon : nana::picture
+{
+    DeferredIcon(nana::paint::image icon, bool cursor_hand = false) : nana::picture()
+    {
+        load(icon);
+        //transparent(true);
+        
+        if (!cursor_hand)
+            return;
+        
+        events().mouse_move(&ui::cursor_hand);
+    }
+protected:
+    void _m_complete_creation() override
     {
         transparent(true);
     }
 };
 
+// skips a collocate when the owner has the same size as at the last one (set dirty after changing the fields)
+struct LayoutMemo
+{
+    nana::size last;
+    bool dirty{ true };
+    
+    bool collocate(nana::place& place, nana::window owner)
+    {
+        auto sz = nana::API::window_size(owner);
+        if (!dirty && sz == last)
+            return false;
+        
+        last = sz;
+        dirty = false;
+        place.collocate();
+        return true;
+    }
+};
+
 struct Panel : nana::panel<false>
 {
     nana::place place{ *this };
+    LayoutMemo memo;
     
     Panel(nana::widget& owner, const char* layout) : nana::panel<false>(owner)
     {
         place.div(layout);
     }
+    
+    bool collocate()
+    {
+        return memo.collocate(place, *this);
+    }
+    
+    void invalidate()
+    {
+        memo.dirty = true;
+    }
 };
 
 struct DeferredPanel : nana::panel<false>
@@ -329,16 +1024,23 @@ struct ToggleIcon : Panel, coreds::HasState<bool>
     {
         place["on_"] << on_;
         place["off_"] << off_;
-        place.collocate();
         place.field_display("off_", false);
+        collocate();
     }
     
     void update(bool on) override
     {
-        place.field_display("on_", on);
-        place.field_display("off_", !on);
-        place.collocate();
+        if (on != shown)
+        {
+            shown = on;
+            place.field_display("on_", on);
+            place.field_display("off_", !on);
+            invalidate();
+        }
+        collocate();
     }
+private:
+    bool shown{ true };
 };
 
 struct DeferredToggleIcon : DeferredPanel, coreds::HasState<bool>
@@ -379,6 +1081,7 @@ protected:
 struct BgPanel : nana::panel<true>
 {
     nana::place place{ *this };
+    LayoutMemo memo;
     
     BgPanel(nana::widget& owner, const char* layout, unsigned bg = 0, unsigned fg = 0) : nana::panel<true>(owner)
     {
@@ -388,6 +1091,16 @@ struct BgPanel : nana::panel<true>
         if (fg)
             fgcolor(nana::color_rgb(fg));
     }
+    
+    bool collocate()
+    {
+        return memo.collocate(place, *this);
+    }
+    
+    void invalidate()
+    {
+        memo.dirty = true;
+    }
 };
 
 struct DeferredBgPanel : nana::panel<true>
@@ -419,29 +1132,30 @@ struct MsgPanel : BgPanel, coreds::HasState<const std::string&>
         "<close_ weight=18>"
     ),  colors(colors)
     {
-        auto listener = [this](nana::label::command cmd, const std::string& target) {
-            if (nana::label::command::click == cmd)
-                hide();
-        };
-        
         place["msg_"] << msg_
                 .text_align(nana::align::left)
                 .transparent(true);
         
         place["close_"] << close_
                 .text_align(nana::align::right)
-                .add_format_listener(listener)
+                .add_format_listener(Delegate<void(nana::label::command, const std::string&)>::bind<MsgPanel, &MsgPanel::onCloseEvent>(this))
                 .format(true)
                 .transparent(true);
         
         close_.fgcolor(colors.close_fg);
         
-        place.collocate();
+        collocate();
         
         // initially hidden
         hide();
     }
     
+    void onCloseEvent(nana::label::command cmd, const std::string& target)
+    {
+        if (nana::label::command::click == cmd)
+            hide();
+    }
+    
     void update(const std::string& msg, Msg type)
     {
         msg_.caption(msg);
@@ -474,19 +1188,201 @@ struct MsgPanel : BgPanel, coreds::HasState<const std::string&>
     }
 };
 
+// read-only log view over a ring buffer of lines, drawing only the visible ones and following the tail
+struct LogView : nana::panel<true>
+{
+private:
+    std::vector<std::string> lines;
+    nana::drawing dw{ *this };
+    nana::timer repaint;
+    const nana::color mark_bg;
+    const unsigned padding;
+    size_t head{ 0 };
+    size_t count{ 0 };
+    int top{ 0 };
+    int visible_lines{ 1 };
+    int mark{ -1 };
+    bool follow{ true };
+    
+    void paint(nana::paint::graphics& graph)
+    {
+        const int line_height = graph.text_extent_size("Wj").height + 2;
+        visible_lines = std::max(1, static_cast<int>(graph.height()) / line_height);
+        
+        const int len = count;
+        if (follow)
+            top = std::max(0, len - visible_lines);
+        
+        const auto fg = fgcolor();
+        int y = 0;
+        for (int i = top; i < len && i < top + visible_lines + 1; i++, y += line_height)
+        {
+            if (i == mark)
+                graph.rectangle({ 0, y, graph.width(), static_cast<unsigned>(line_height) }, true, mark_bg);
+            
+            graph.string({ static_cast<int>(padding), y + 1 }, line(i), fg);
+        }
+    }
+    void invalidate()
+    {
+        repaint.start();
+    }
+public:
+    LogView(nana::widget& owner, size_t capacity, unsigned mark_bg = 0xF6F3D5, unsigned padding = 3):
+        nana::panel<true>(owner),
+        lines(capacity ? capacity : 1),
+        mark_bg(nana::color_rgb(mark_bg)),
+        padding(padding)
+    {
+        bgcolor(nana::colors::white);
+        dw.draw([this](nana::paint::graphics& graph) {
+            paint(graph);
+        });
+        repaint.interval(30);
+        repaint.elapse([this]() {
+            repaint.stop();
+            nana::API::refresh_window(*this);
+        });
+        events().mouse_wheel([this](const nana::arg_wheel& arg) {
+            if (arg.which == nana::arg_wheel::wheel::vertical)
+                scrollTo(top + (arg.upwards ? -3 : 3));
+        });
+    }
+    
+    int size()
+    {
+        return count;
+    }
+    
+    // 0 is the oldest kept
+    const std::string& line(int idx)
+    {
+        return lines[(head + idx) % lines.size()];
+    }
+    
+    void append(const std::string& text)
+    {
+        if (count < lines.size())
+        {
+            // assign reuses the capacity of the overwritten string
+            lines[(head + count++) % lines.size()].assign(text);
+        }
+        else
+        {
+            lines[head].assign(text);
+            head = (head + 1) % lines.size();
+            // keep the view and the mark on the same lines
+            if (!follow && top > 0)
+                top--;
+            if (mark != -1)
+                mark--;
+        }
+        invalidate();
+    }
+    
+    void clear()
+    {
+        head = 0;
+        count = 0;
+        top = 0;
+        mark = -1;
+        follow = true;
+        invalidate();
+    }
+    
+    void scrollTo(int idx)
+    {
+        int max = std::max(0, static_cast<int>(count) - visible_lines);
+        top = std::max(0, std::min(idx, max));
+        follow = top == max;
+        invalidate();
+    }
+    
+    // the first line containing the needle or -1
+    int find(const std::string& needle, int from = 0, bool backwards = false)
+    {
+        const int len = count;
+        for (int i = from; i >= 0 && i < len; i += backwards ? -1 : 1)
+        {
+            if (std::string::npos != line(i).find(needle))
+                return i;
+        }
+        return -1;
+    }
+    
+    // highlights the line (-1 clears) and scrolls it into view
+    void reveal(int idx)
+    {
+        mark = idx;
+        if (idx != -1 && (idx < top || idx >= top + visible_lines))
+            scrollTo(idx - visible_lines / 2);
+        else
+            invalidate();
+    }
+};
+
 namespace fonts {
 
-const nana::paint::font r8("", 8); // max ph: 16
-const nana::paint::font r9("", 9); // max ph: 18
-const nana::paint::font r10("", 10); // max ph: 22
-const nana::paint::font r11("", 11); // max ph: 24
-const nana::paint::font r12("", 12); // max ph: 27
-const nana::paint::font r14("", 14); // max ph: 32
-const nana::paint::font r16("", 16); // max ph: 36
-const nana::paint::font r18("", 18); // max ph: 41
-const nana::paint::font r20("", 20); // max ph: 46
-const nana::paint::font r22("", 22); // max ph: 51
-const nana::paint::font r24("", 24); // max ph: 56
+// the process-wide font for the size and style, valid for the life of the process
+inline const nana::paint::font& get(double size, bool bold = false, bool italic = false)
+{
+    static std::mutex mutex;
+    static std::map<std::tuple<double, bool, bool>, std::unique_ptr<nana::paint::font>> interned;
+    
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& f = interned[std::make_tuple(size, bold, italic)];
+    if (!f)
+    {
+        nana::paint::font::font_style fs;
+        fs.weight = bold ? 700 : 400;
+        fs.italic = italic;
+        f.reset(new nana::paint::font("", size, fs));
+    }
+    return *f;
+}
+
+// a font handle that is only resolved (see get) when used
+struct Ref
+{
+    const double size_;
+    const bool bold_;
+    const bool italic_;
+    
+    constexpr Ref(double size, bool bold = false, bool italic = false):
+        size_(size), bold_(bold), italic_(italic)
+    {
+        
+    }
+    // like nana::paint::font::size()
+    constexpr double size() const
+    {
+        return size_;
+    }
+    constexpr Ref bold() const
+    {
+        return Ref(size_, true, italic_);
+    }
+    constexpr Ref italic() const
+    {
+        return Ref(size_, bold_, true);
+    }
+    operator const nana::paint::font&() const
+    {
+        return get(size_, bold_, italic_);
+    }
+};
+
+constexpr Ref r8(8); // max ph: 16
+constexpr Ref r9(9); // max ph: 18
+constexpr Ref r10(10); // max ph: 22
+constexpr Ref r11(11); // max ph: 24
+constexpr Ref r12(12); // max ph: 27
+constexpr Ref r14(14); // max ph: 32
+constexpr Ref r16(16); // max ph: 36
+constexpr Ref r18(18); // max ph: 41
+constexpr Ref r20(20); // max ph: 46
+constexpr Ref r22(22); // max ph: 51
+constexpr Ref r24(24); // max ph: 56
 
 } // fonts
 
@@ -533,8 +1429,106 @@ const char* const input24 = "margin=[9,1,1,1]<_>";
 
 struct Input : BgPanel
 {
+private:
+    // the result of a validation running off the ui thread
+    struct Validation
+    {
+        std::mutex mutex;
+        const int gen;
+        bool done{ false };
+        std::string result;
+        
+        Validation(int gen): gen(gen)
+        {
+            
+        }
+    };
+    struct Debounce
+    {
+        nana::timer quiet;
+        nana::timer poll;
+        std::function<void(const std::string& value)> settled;
+        std::function<std::string(const std::string& value)> validator;
+        coreds::HasState<const std::string&>* target{ nullptr };
+        std::shared_ptr<Validation> pending;
+        // bumped on every change so that stale results are dropped
+        int gen{ 0 };
+    };
+    std::unique_ptr<Debounce> debounce;
+    
+    Debounce& initDebounce()
+    {
+        if (debounce)
+            return *debounce;
+        
+        debounce.reset(new Debounce);
+        auto& d = *debounce;
+        d.quiet.interval(300);
+        d.quiet.elapse([this]() {
+            onQuiet();
+        });
+        d.poll.interval(15);
+        d.poll.elapse([this]() {
+            onPoll();
+        });
+        $.events().text_changed([this](const nana::arg_textbox& arg) {
+            auto& d = *debounce;
+            d.gen++;
+            d.pending.reset();
+            d.poll.stop();
+            d.quiet.stop();
+            d.quiet.start();
+        });
+        return d;
+    }
+    void onQuiet()
+    {
+        auto& d = *debounce;
+        d.quiet.stop();
+        
+        auto value = $.caption();
+        if (d.settled)
+            d.settled(value);
+        
+        if (!d.validator)
+            return;
+        
+        auto v = std::make_shared<Validation>(d.gen);
+        auto validator = d.validator;
+        d.pending = v;
+        std::thread([v, validator, value]() {
+            auto result = validator(value);
+            std::lock_guard<std::mutex> lock(v->mutex);
+            v->result = std::move(result);
+            v->done = true;
+        }).detach();
+        d.poll.start();
+    }
+    void onPoll()
+    {
+        auto& d = *debounce;
+        auto v = d.pending;
+        if (!v)
+        {
+            d.poll.stop();
+            return;
+        }
+        
+        std::lock_guard<std::mutex> lock(v->mutex);
+        if (!v->done)
+            return;
+        
+        d.poll.stop();
+        d.pending.reset();
+        if (v->gen == d.gen && d.target)
+            d.target->update(v->result);
+    }
+public:
     static const char* $layout(int size, int* flex_height)
     {
+        if (auto m = metrics())
+            return m->layout(Metrics::Kind::INPUT, size, flex_height);
+        
         switch (size)
         {
             case 8: if (flex_height) *flex_height += h8; return input8;
@@ -580,7 +1574,10 @@ struct Input : BgPanel
         if (!placeholder.empty())
             $.tip_string(placeholder);
         
-        place.collocate();
+        collocate();
+        
+        if (auto m = metrics())
+            m->track(*this, place, Metrics::Kind::INPUT, font, &$);
     }
     nana::textbox& bg(const nana::color& color)
     {
@@ -588,6 +1585,22 @@ struct Input : BgPanel
         bgcolor(color);
         return $;
     }
+    
+    // calls fn once the text stops changing for quiet_ms
+    void settle(std::function<void(const std::string& value)> fn, unsigned quiet_ms = 300)
+    {
+        auto& d = initDebounce();
+        d.settled = std::move(fn);
+        d.quiet.interval(quiet_ms);
+    }
+    
+    // runs fn on a worker once the text settles, its error (empty when valid) goes to target unless the text changed
+    void validate(std::function<std::string(const std::string& value)> fn, coreds::HasState<const std::string&>* target)
+    {
+        auto& d = initDebounce();
+        d.validator = std::move(fn);
+        d.target = target;
+    }
 };
 
 #ifdef WIN32
@@ -620,6 +1633,9 @@ struct Label : BgPanel
 {
     static const char* $layout(int size, int* flex_height)
     {
+        if (auto m = metrics())
+            return m->layout(Metrics::Kind::LABEL, size, flex_height);
+        
         switch (size)
         {
             case 8: if (flex_height) *flex_height += h8; return label8;
@@ -654,7 +1670,10 @@ struct Label : BgPanel
         if (!text.empty())
             $.caption(text);
         
-        place.collocate();
+        collocate();
+        
+        if (auto m = metrics())
+            m->track(*this, place, Metrics::Kind::LABEL, font, &$);
     }
     nana::label& bg(const nana::color& color)
     {
@@ -691,6 +1710,9 @@ protected:
         
         place["_"] << $;
         place.collocate();
+        
+        if (auto m = metrics())
+            m->track(*this, place, Metrics::Kind::LABEL, font, &$);
     }
 };
 
@@ -720,6 +1742,9 @@ struct Checkbox : BgPanel, coreds::HasState<bool>
 {
     static const char* $layout(int size, int* flex_height)
     {
+        if (auto m = metrics())
+            return m->layout(Metrics::Kind::CHECKBOX, size, flex_height);
+        
         switch (size)
         {
             case 10: if (flex_height) *flex_height += h10; return checkbox10;
@@ -736,11 +1761,20 @@ struct Checkbox : BgPanel, coreds::HasState<bool>
     }
     
 private:
-    std::function<void()> $toggle{
-        std::bind(&Checkbox::toggle, this)
+    Delegate<void()> $toggle{
+        Delegate<void()>::bind<Checkbox, &Checkbox::toggle>(this)
     };
     
     bool val;
+    
+    void applyValue(bool on)
+    {
+        val = on;
+        place.field_display("on_", on);
+        place.field_display("off_", !on);
+        invalidate();
+        collocate();
+    }
 public:
     Icon on_;
     Icon off_;
@@ -780,11 +1814,19 @@ public:
         if (!text.empty())
             $.caption(text);
         
-        place.collocate();
         if (value)
             place.field_display("off_", false);
         else
             place.field_display("on_", false);
+        collocate();
+        
+        if (auto m = metrics())
+        {
+            m->track(*this, place, Metrics::Kind::CHECKBOX, font, &$, [this]() {
+                // the new div reset the fields
+                applyValue(val);
+            });
+        }
     }
     void toggle()
     {
@@ -792,10 +1834,10 @@ public:
     }
     void update(bool on) override
     {
-        val = on;
-        place.field_display("on_", on);
-        place.field_display("off_", !on);
-        place.collocate();
+        if (on != val)
+            applyValue(on);
+        else
+            collocate();
     }
     bool value()
     {
@@ -810,33 +1852,421 @@ public:
 
 } // w$
 
-template <typename T, typename W>
-struct List : Panel
+// record indexes as disjoint [start, end) ranges
+struct Selection
 {
 private:
-    std::forward_list<W> items;
-    std::vector<W*> array;
-    nana::color selected_bg;
-    int selected_idx{ -1 };
-    
-public:    
-    List(nana::widget& owner, const char* layout = nullptr, unsigned selected_bg = 0xF3F3F3):
-        Panel(owner, layout ? layout : "margin=[5,0] <items_ vert>"),
-        selected_bg(nana::color_rgb(selected_bg))
+    std::map<int, int> ranges;
+    int anchor{ -1 };
+public:
+    void add(int start, int end)
     {
+        if (start >= end)
+            return;
         
+        auto it = ranges.upper_bound(start);
+        if (it != ranges.begin())
+        {
+            auto prev = std::prev(it);
+            if (prev->second >= start)
+            {
+                start = prev->first;
+                end = std::max(end, prev->second);
+                ranges.erase(prev);
+            }
+        }
+        while (it != ranges.end() && it->first <= end)
+        {
+            end = std::max(end, it->second);
+            it = ranges.erase(it);
+        }
+        ranges.emplace_hint(it, start, end);
     }
     
-    void collocate(int pageSize = 10)
+    void remove(int start, int end)
     {
+        if (start >= end)
+            return;
+        
+        auto it = ranges.upper_bound(start);
+        if (it != ranges.begin())
+        {
+            auto prev = std::prev(it);
+            int prev_end = prev->second;
+            if (prev_end > start)
+            {
+                if (prev->first == start)
+                    ranges.erase(prev);
+                else
+                    prev->second = start;
+                
+                if (prev_end > end)
+                {
+                    ranges.emplace(end, prev_end);
+                    return;
+                }
+            }
+        }
+        while (it != ranges.end() && it->first < end)
+        {
+            int it_end = it->second;
+            it = ranges.erase(it);
+            if (it_end > end)
+            {
+                ranges.emplace_hint(it, end, it_end);
+                break;
+            }
+        }
+    }
+    
+    bool contains(int idx)
+    {
+        auto it = ranges.upper_bound(idx);
+        return it != ranges.begin() && idx < (--it)->second;
+    }
+    
+    void toggle(int idx)
+    {
+        if (contains(idx))
+            remove(idx, idx + 1);
+        else
+            add(idx, idx + 1);
+    }
+    
+    // shift extends from the anchor, ctrl toggles, neither selects only idx
+    void pick(int idx, bool ctrl, bool shift)
+    {
+        if (shift && anchor != -1)
+        {
+            if (!ctrl)
+                ranges.clear();
+            add(std::min(anchor, idx), std::max(anchor, idx) + 1);
+            return;
+        }
+        
+        if (ctrl)
+        {
+            toggle(idx);
+        }
+        else
+        {
+            ranges.clear();
+            add(idx, idx + 1);
+        }
+        anchor = idx;
+    }
+    
+    void clear()
+    {
+        ranges.clear();
+        anchor = -1;
+    }
+    
+    bool empty()
+    {
+        return ranges.empty();
+    }
+    
+    int64_t count()
+    {
+        int64_t n = 0;
+        for (auto& r : ranges)
+            n += r.second - r.first;
+        return n;
+    }
+    
+    template <typename F>
+    void forEach(F fn)
+    {
+        for (auto& r : ranges)
+        {
+            for (int i = r.first; i < r.second; i++)
+                fn(i);
+        }
+    }
+};
+
+// paints the selected, hovered and marked rows by setting their bg, or in layered mode by moving layers
+// beneath see-through rows (create it before the rows)
+struct RowHighlight
+{
+private:
+    typedef nana::panel<true> Layer;
+    
+    struct Mark
+    {
+        Layer layer;
+        nana::drawing dw{ layer };
+        
+        Mark(nana::window owner, const nana::color& bg): layer(owner)
+        {
+            layer.bgcolor(bg);
+            ui::visible(layer, false);
+        }
+    };
+    const nana::window owner;
+    const nana::color selected_bg;
+    const nana::color focus_fg;
+    std::unique_ptr<Layer> hover_;
+    std::unique_ptr<Layer> selected_;
+    std::unique_ptr<nana::drawing> dw;
+    std::forward_list<Mark> marks;
+    // the layers by slot (layered mode only)
+    std::vector<Mark*> mark_array;
+    // the row marked by each slot
+    std::vector<nana::window> marked;
+    nana::window hover_row{ nullptr };
+    nana::window selected_row{ nullptr };
+    bool focused{ false };
+    
+    static void moveTo(Layer& layer, nana::window row)
+    {
+        if (!row)
+        {
+            ui::visible(layer, false);
+            return;
+        }
+        
+        auto pos = nana::API::window_position(row);
+        auto sz = nana::API::window_size(row);
+        nana::API::move_window(layer, { pos.x, pos.y, sz.width, sz.height });
+        ui::visible(layer, true);
+    }
+    void sync(nana::window row)
+    {
+        if (row == selected_row || row == hover_row)
+        {
+            moveTo(*selected_, selected_row);
+            moveTo(*hover_, hover_row == selected_row ? nullptr : hover_row);
+        }
+        for (int i = 0, len = mark_array.size(); i < len; i++)
+        {
+            if (marked[i] == row)
+                moveTo(mark_array[i]->layer, row);
+        }
+    }
+    void drawFocus(nana::paint::graphics& graph)
+    {
+        if (!focused)
+            return;
+        
+        border_top(graph, focus_fg);
+        border_bottom(graph, focus_fg);
+        border_left(graph, focus_fg);
+        border_right(graph, focus_fg);
+    }
+    // the marks sit above the selected layer, so a mark on the cursor row carries the focus border
+    void updateFocus(nana::window row)
+    {
+        for (int i = 0, len = mark_array.size(); row && i < len; i++)
+        {
+            if (marked[i] == row)
+                mark_array[i]->dw.update();
+        }
+    }
+    // bg mode
+    void paint(nana::window row)
+    {
+        if (!row)
+            return;
+        
+        bool on = row == selected_row;
+        for (int i = 0, len = marked.size(); !on && i < len; i++)
+            on = marked[i] == row;
+        
+        nana::API::bgcolor(row, on ? selected_bg : nana::colors::white);
+    }
+public:
+    RowHighlight(nana::widget& owner, const nana::color& selected_bg, const nana::color& hover_bg,
+            bool layered = false, unsigned focus_fg = 0xDDDDDD):
+        owner(owner.handle()),
+        selected_bg(selected_bg),
+        focus_fg(nana::color_rgb(focus_fg))
+    {
+        if (!layered)
+            return;
+        
+        hover_.reset(new Layer(owner));
+        selected_.reset(new Layer(owner));
+        hover_->bgcolor(hover_bg);
+        selected_->bgcolor(selected_bg);
+        ui::visible(*hover_, false);
+        ui::visible(*selected_, false);
+        
+        dw.reset(new nana::drawing(*selected_));
+        dw->draw([this](nana::paint::graphics& graph) {
+            drawFocus(graph);
+        });
+        
+        // leaving a row through one of its children only reaches the container
+        owner.events().mouse_leave([this](const nana::arg_mouse& arg) {
+            hover(nullptr);
+        });
+        owner.events().mouse_move([this](const nana::arg_mouse& arg) {
+            hover(nullptr);
+        });
+    }
+    
+    bool layered()
+    {
+        return selected_ != nullptr;
+    }
+    
+    // layered mode
+    void track(nana::widget& row)
+    {
+        if (!layered())
+            return;
+        
+        auto wd = row.handle();
+        row.events().mouse_enter([this, wd](const nana::arg_mouse& arg) {
+            hover(wd);
+        });
+        row.events().mouse_leave([this, wd](const nana::arg_mouse& arg) {
+            // entering a child of the row also leaves it
+            auto sz = nana::API::window_size(wd);
+            if (arg.pos.x < 0 || arg.pos.y < 0 || arg.pos.x >= static_cast<int>(sz.width) || arg.pos.y >= static_cast<int>(sz.height))
+                hover(nullptr);
+        });
+        row.events().move([this, wd](const nana::arg_move& arg) {
+            sync(wd);
+        });
+        row.events().resized([this, wd](const nana::arg_resized& arg) {
+            sync(wd);
+        });
+    }
+    
+    void select(nana::window row)
+    {
+        if (row == selected_row)
+            return;
+        
+        auto prev = selected_row;
+        selected_row = row;
+        if (!layered())
+        {
+            paint(prev);
+            paint(row);
+            return;
+        }
+        
+        moveTo(*selected_, selected_row);
+        moveTo(*hover_, hover_row == selected_row ? nullptr : hover_row);
+        if (focused)
+        {
+            updateFocus(prev);
+            updateFocus(row);
+        }
+    }
+    
+    // one slot per row for the marks, call before the rows are created
+    void reserve(int count)
+    {
+        while (static_cast<int>(marked.size()) < count)
+        {
+            marked.push_back(nullptr);
+            if (!layered())
+                continue;
+            
+            int slot = mark_array.size();
+            marks.emplace_front(owner, selected_bg);
+            marks.front().dw.draw([this, slot](nana::paint::graphics& graph) {
+                if (marked[slot] && marked[slot] == selected_row)
+                    drawFocus(graph);
+            });
+            mark_array.push_back(&marks.front());
+        }
+    }
+    
+    // nullptr clears
+    void mark(int slot, nana::window row)
+    {
+        auto prev = marked[slot];
+        if (prev == row)
+            return;
+        
+        marked[slot] = row;
+        if (!layered())
+        {
+            paint(prev);
+            paint(row);
+            return;
+        }
+        
+        moveTo(mark_array[slot]->layer, row);
+        if (focused && selected_row && (row == selected_row || prev == selected_row))
+            mark_array[slot]->dw.update();
+    }
+    
+    void hover(nana::window row)
+    {
+        if (row == hover_row || !layered())
+            return;
+        
+        hover_row = row;
+        moveTo(*hover_, hover_row == selected_row ? nullptr : hover_row);
+    }
+    
+    void focus(bool on)
+    {
+        if (on == focused || !layered())
+            return;
+        
+        focused = on;
+        if (!selected_row)
+            return;
+        
+        dw->update();
+        updateFocus(selected_row);
+    }
+};
+
+template <typename T, typename W>
+struct List : Panel
+{
+    Selection selection;
+    // receives the pojos of every selected row in one call (see batch)
+    std::function<void(const std::vector<T*>& pojos)> $onBatch;
+    
+private:
+    std::forward_list<W> items;
+    std::vector<W*> array;
+    std::vector<T*> pojos;
+    RowHighlight highlight;
+    int selected_idx{ -1 };
+    
+    void syncMarks()
+    {
+        for (int i = 0, len = array.size(); i < len; i++)
+            highlight.mark(i, selection.contains(i) ? array[i]->handle() : nullptr);
+    }
+    
+public:    
+    List(nana::widget& owner, const char* layout = nullptr, unsigned selected_bg = 0xF3F3F3, unsigned hover_bg = 0xF9F9F9,
+            bool layered = false):
+        Panel(owner, layout ? layout : "margin=[5,0] <items_ vert>"),
+        highlight(*this, nana::color_rgb(selected_bg), nana::color_rgb(hover_bg), layered)
+    {
+        events().focus([this](const nana::arg_focus& arg) {
+            highlight.focus(arg.getting);
+        });
+    }
+    
+    void collocate(int pageSize = 10)
+    {
+        highlight.reserve(array.size() + pageSize);
         for (int i = 0; i < pageSize; i++)
         {
             items.emplace_front(*this);
             place["items_"] << items.front();
             array.push_back(&items.front());
+            pojos.push_back(nullptr);
+            highlight.track(items.front());
         }
         
-        place.collocate();
+        // the rows are new fields
+        Panel::invalidate();
+        Panel::collocate();
     }
     
     int size()
@@ -846,32 +2276,414 @@ public:
     
     void populate(int idx, T* pojo)
     {
+        pojos[idx] = pojo;
         array[idx]->update(pojo);
     }
     
+    // shift/ctrl semantics (see Selection::pick)
+    void pick(int idx, bool ctrl, bool shift)
+    {
+        if (idx < 0 || idx >= static_cast<int>(array.size()))
+            return;
+        
+        trySelect(idx);
+        selection.pick(idx, ctrl, shift);
+        syncMarks();
+    }
+    
+    void selectAll()
+    {
+        selection.add(0, array.size());
+        syncMarks();
+    }
+    
+    void deselectAll()
+    {
+        selection.clear();
+        syncMarks();
+    }
+    
+    void batch()
+    {
+        if (!$onBatch)
+            return;
+        
+        std::vector<T*> out;
+        selection.forEach([this, &out](int idx) {
+            if (idx < static_cast<int>(pojos.size()) && pojos[idx])
+                out.push_back(pojos[idx]);
+        });
+        $onBatch(out);
+    }
+    
     bool trySelect(int idx)
     {
-        int prev_idx = selected_idx;
-        if (idx == prev_idx)
+        if (idx == selected_idx || idx < -1 || idx >= static_cast<int>(array.size()))
             return false;
         
-        if (idx == -1)
+        selected_idx = idx;
+        highlight.select(idx == -1 ? nullptr : array[idx]->handle());
+        return true;
+    }
+};
+
+// scrolls by pixels, with only the rows in the viewport, recycled as they scroll out
+template <typename T, typename W>
+struct ScrollList : nana::panel<false>
+{
+    // returns the record at idx or nullptr when not loaded yet (call refresh once it is)
+    std::function<T*(int idx)> $fetch;
+    
+private:
+    std::forward_list<W> items;
+    std::vector<W*> array;
+    // the record index each row currently shows
+    std::vector<int> indexes;
+    nana::scroll<true> bar{ *this };
+    RowHighlight highlight;
+    const int row_height;
+    const unsigned bar_width;
+    int selected_idx{ -1 };
+    int total{ 0 };
+    int offset{ 0 };
+    bool syncing{ false };
+    
+    int viewHeight()
+    {
+        return nana::API::window_size(*this).height;
+    }
+    int maxOffset()
+    {
+        int max = total * row_height - viewHeight();
+        return max > 0 ? max : 0;
+    }
+    void ensureRows()
+    {
+        size_t count = viewHeight() / row_height + 2;
+        if (count <= array.size())
+            return;
+        
+        while (array.size() < count)
         {
-            // deselect
-            selected_idx = idx;
-            array[prev_idx]->bgcolor(nana::colors::white);
-            return true;
+            items.emplace_front(*this);
+            array.push_back(&items.front());
+            indexes.push_back(-1);
+            highlight.track(items.front());
+        }
+        
+        // the slot of each record changed
+        std::fill(indexes.begin(), indexes.end(), -1);
+    }
+    void syncBar()
+    {
+        auto sz = nana::API::window_size(*this);
+        nana::API::move_window(bar, { static_cast<int>(sz.width) - static_cast<int>(bar_width), 0, bar_width, sz.height });
+        
+        syncing = true;
+        bar.amount(total * row_height);
+        bar.range(sz.height);
+        bar.step(row_height);
+        bar.value(offset);
+        syncing = false;
+    }
+    void layout()
+    {
+        auto sz = nana::API::window_size(*this);
+        unsigned width = sz.width > bar_width ? sz.width - bar_width : 0;
+        int first = offset / row_height;
+        int shift = offset % row_height;
+        int slots = array.size();
+        for (int k = 0; k < slots; k++)
+        {
+            int idx = first + k;
+            int slot = idx % slots;
+            W* row = array[slot];
+            if (idx >= total)
+            {
+                indexes[slot] = -1;
+                ui::visible(*row, false);
+                continue;
+            }
+            
+            if (indexes[slot] != idx)
+            {
+                indexes[slot] = idx;
+                row->update($fetch ? $fetch(idx) : nullptr);
+            }
+            
+            nana::API::move_window(*row, { 0, k * row_height - shift, width, static_cast<unsigned>(row_height) });
+            ui::visible(*row, true);
         }
         
-        if (idx < 0 || idx >= array.size())
+        auto selected = rowOf(selected_idx);
+        highlight.select(selected ? selected->handle() : nullptr);
+    }
+    W* rowOf(int idx)
+    {
+        if (idx < 0 || array.empty())
+            return nullptr;
+        
+        int slot = idx % array.size();
+        return indexes[slot] == idx ? array[slot] : nullptr;
+    }
+public:
+    ScrollList(nana::widget& owner, int row_height, unsigned selected_bg = 0xF3F3F3, unsigned hover_bg = 0xF9F9F9,
+            unsigned bar_width = 16, bool layered = false):
+        nana::panel<false>(owner),
+        highlight(*this, nana::color_rgb(selected_bg), nana::color_rgb(hover_bg), layered),
+        row_height(row_height),
+        bar_width(bar_width)
+    {
+        events().focus([this](const nana::arg_focus& arg) {
+            highlight.focus(arg.getting);
+        });
+        bar.events().value_changed([this](const nana::arg_scroll& arg) {
+            if (!syncing)
+                scrollTo(bar.value());
+        });
+        events().mouse_wheel([this](const nana::arg_wheel& arg) {
+            if (arg.which == nana::arg_wheel::wheel::vertical)
+                scrollBy((arg.upwards ? -1 : 1) * this->row_height * 3);
+        });
+        events().resized([this](const nana::arg_resized& arg) {
+            ensureRows();
+            scrollTo(offset < maxOffset() ? offset : maxOffset(), true);
+        });
+    }
+    
+    // re-fetches the visible records
+    void size(int count)
+    {
+        total = count;
+        if (selected_idx >= total)
+            selected_idx = -1;
+        
+        ensureRows();
+        refresh();
+    }
+    
+    int size()
+    {
+        return total;
+    }
+    
+    void refresh()
+    {
+        std::fill(indexes.begin(), indexes.end(), -1);
+        scrollTo(offset < maxOffset() ? offset : maxOffset(), true);
+    }
+    
+    // if visible
+    void refresh(int idx)
+    {
+        if (auto row = rowOf(idx))
+            row->update($fetch ? $fetch(idx) : nullptr);
+    }
+    
+    void scrollTo(int px, bool force = false)
+    {
+        int max = maxOffset();
+        if (px > max)
+            px = max;
+        if (px < 0)
+            px = 0;
+        
+        if (px == offset && !force)
+            return;
+        
+        offset = px;
+        syncBar();
+        layout();
+    }
+    
+    void scrollBy(int px)
+    {
+        scrollTo(offset + px);
+    }
+    
+    // scrolls the least needed to show the record fully
+    void reveal(int idx)
+    {
+        int top = idx * row_height;
+        if (top < offset)
+            scrollTo(top);
+        else if (top + row_height > offset + viewHeight())
+            scrollTo(top + row_height - viewHeight());
+    }
+    
+    int getSelectedIdx()
+    {
+        return selected_idx;
+    }
+    
+    bool trySelect(int idx)
+    {
+        if (idx == selected_idx || idx < -1 || idx >= total)
             return false;
         
         selected_idx = idx;
         
-        if (prev_idx != -1)
-            array[prev_idx]->bgcolor(nana::colors::white);
+        if (idx != -1)
+            reveal(idx);
+        
+        auto row = rowOf(idx);
+        highlight.select(row ? row->handle() : nullptr);
+        return true;
+    }
+};
+
+template <typename T>
+struct Column
+{
+    unsigned width;
+    nana::align align;
+    // writes the cell text into out (reused across cells)
+    std::function<void(const T& pojo, std::string& out)> format;
+};
+
+// paints the cells itself instead of a widget per row, formatting only what intersects the window
+template <typename T>
+struct Grid : nana::panel<true>
+{
+private:
+    std::vector<Column<T>> columns;
+    std::vector<T*> rows;
+    nana::drawing dw{ *this };
+    std::string buf;
+    const unsigned row_height;
+    const unsigned padding;
+    nana::color selected_bg;
+    int selected_idx{ -1 };
+    int offset_x{ 0 };
+    
+    int contentWidth()
+    {
+        int w = 0;
+        for (auto& c : columns)
+            w += c.width;
+        return w;
+    }
+    void paint(nana::paint::graphics& graph)
+    {
+        const int width = graph.width();
+        const int height = graph.height();
+        const int text_h = graph.text_extent_size("Wj").height;
+        const int text_y = (static_cast<int>(row_height) - text_h) / 2;
+        const auto fg = fgcolor();
+        
+        int y = 0;
+        for (int i = 0, len = rows.size(); i < len && y < height; i++, y += row_height)
+        {
+            if (i == selected_idx)
+                graph.rectangle({ 0, y, static_cast<unsigned>(width), row_height }, true, selected_bg);
+            
+            T* pojo = rows[i];
+            if (!pojo)
+                continue;
+            
+            int x = -offset_x;
+            for (auto& c : columns)
+            {
+                int right = x + static_cast<int>(c.width);
+                if (right <= 0)
+                {
+                    // scrolled out on the left
+                    x = right;
+                    continue;
+                }
+                if (x >= width)
+                    break;
+                
+                buf.clear();
+                c.format(*pojo, buf);
+                
+                // clear the cell so that the previous cell's overflow is cut
+                if (x > 0)
+                    graph.rectangle({ x, y, c.width, row_height }, true, i == selected_idx ? selected_bg : bgcolor());
+                
+                if (!buf.empty())
+                {
+                    int text_x = x + padding;
+                    if (c.align != nana::align::left)
+                    {
+                        int space = static_cast<int>(c.width - padding * 2) - static_cast<int>(graph.text_extent_size(buf).width);
+                        // too wide, left aligned so that the next cell cuts it instead of it covering the previous one
+                        if (space > 0)
+                            text_x += c.align == nana::align::right ? space : space / 2;
+                    }
+                    graph.string({ text_x, y + text_y }, buf, fg);
+                }
+                
+                x = right;
+            }
+        }
+    }
+public:
+    Grid(nana::widget& owner, unsigned row_height, unsigned selected_bg = 0xF3F3F3, unsigned padding = 5):
+        nana::panel<true>(owner),
+        row_height(row_height),
+        padding(padding),
+        selected_bg(nana::color_rgb(selected_bg))
+    {
+        bgcolor(nana::colors::white);
+        dw.draw([this](nana::paint::graphics& graph) {
+            paint(graph);
+        });
+        events().mouse_wheel([this](const nana::arg_wheel& arg) {
+            if (arg.which == nana::arg_wheel::wheel::horizontal || arg.shift)
+                scrollTo(offset_x + (arg.upwards ? -1 : 1) * static_cast<int>(arg.distance / 2));
+        });
+    }
+    
+    void column(unsigned width, nana::align align, std::function<void(const T& pojo, std::string& out)> format)
+    {
+        columns.push_back({ width, align, std::move(format) });
+    }
+    
+    void collocate(int pageSize = 10)
+    {
+        rows.assign(pageSize, nullptr);
+    }
+    
+    int size()
+    {
+        return rows.size();
+    }
+    
+    // call refresh() once the page is populated
+    void populate(int idx, T* pojo)
+    {
+        rows[idx] = pojo;
+    }
+    
+    void refresh()
+    {
+        nana::API::refresh_window(*this);
+    }
+    
+    // pixel offset
+    void scrollTo(int x)
+    {
+        int max = contentWidth() - static_cast<int>(nana::API::window_size(*this).width);
+        if (x > max)
+            x = max;
+        if (x < 0)
+            x = 0;
+        
+        if (x == offset_x)
+            return;
+        
+        offset_x = x;
+        refresh();
+    }
+    
+    bool trySelect(int idx)
+    {
+        if (idx == selected_idx || idx < -1 || idx >= static_cast<int>(rows.size()))
+            return false;
         
-        array[idx]->bgcolor(selected_bg);
+        selected_idx = idx;
+        refresh();
         return true;
     }
 };